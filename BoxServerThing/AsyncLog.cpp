@@ -0,0 +1,86 @@
+/**
+ * @file AsyncLog.cpp
+ * @brief Υλοποίηση του μη-μπλοκάροντος logging (βλ. AsyncLog.h).
+ *
+ * Στο UNO R4 WiFi όλο το sketch (ArduinoCloud.update, BLE.poll και τα callbacks τους)
+ * τρέχει στο ίδιο νήμα με την `loop()`, οπότε ο ring buffer έχει έναν παραγωγό και
+ * έναν καταναλωτή στο ίδιο context και δεν χρειάζεται κλείδωμα.
+ */
+
+#include "AsyncLog.h"
+#include <stdarg.h>
+
+static const uint8_t kLogSlots    = 16;   ///< Πλήθος γραμμών στον ring buffer.
+static const size_t  kLogLineSize = 128;  ///< Μέγιστο μήκος γραμμής (οι μεγαλύτερες κόβονται).
+
+static char     logLines[kLogSlots][kLogLineSize];
+static uint8_t  logLengths[kLogSlots];
+static uint8_t  logHead = 0;        ///< Επόμενη ελεύθερη θέση.
+static uint8_t  logTail = 0;        ///< Παλαιότερη γραμμή που δεν έχει γραφτεί.
+static uint8_t  logCount = 0;
+static size_t   logOffset = 0;      ///< Πόσα bytes της παλαιότερης γραμμής έχουν ήδη γραφτεί.
+static uint32_t logDropped = 0;
+static uint32_t logReportedDrops = 0;
+
+static const char* const kLevelPrefix[] = { "", "E ", "W ", "I ", "D " };
+
+void logWrite(uint8_t level, const char* format, ...) {
+  if (logCount == kLogSlots) {
+    logDropped++;
+    return;
+  }
+  char* line = logLines[logHead];
+  const char* prefix = kLevelPrefix[level <= LOG_LEVEL_DEBUG ? level : 0];
+  size_t length = strlen(prefix);
+  memcpy(line, prefix, length);
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(line + length, kLogLineSize - 1 - length, format, args);
+  va_end(args);
+  if (written > 0) {
+    length += (size_t)written < kLogLineSize - 2 - length ? written : kLogLineSize - 2 - length;
+  }
+  line[length++] = '\n';
+  logLengths[logHead] = length;
+
+  logHead = (logHead + 1) % kLogSlots;
+  logCount++;
+}
+
+void logDrain() {
+  if (logDropped != logReportedDrops && logCount < kLogSlots) {
+    uint32_t drops = logDropped - logReportedDrops;
+    logReportedDrops = logDropped;
+    logWrite(LOG_LEVEL_WARN, "[LOG] %lu lines dropped", (unsigned long)drops);
+  }
+  while (logCount > 0) {
+    size_t remaining = logLengths[logTail] - logOffset;
+#if LOG_SERIAL_TX_ROOM
+    // Όσο χώρο έχει το buffer αποστολής της σειριακής· γεμάτο (0): συνέχεια
+    // στην επόμενη επανάληψη της loop() αντί για write που θα περίμενε.
+    int room = Serial.availableForWrite();
+    if (room <= 0) {
+      return;
+    }
+    size_t chunk = (size_t)room < remaining ? (size_t)room : remaining;
+#else
+    size_t chunk = remaining;  // Ο πυρήνας δεν αναφέρει χώρο: μία γραμμή ανά επανάληψη.
+#endif
+    Serial.write((const uint8_t*)logLines[logTail] + logOffset, chunk);
+    logOffset += chunk;
+    if (logOffset < logLengths[logTail]) {
+      return;  // Η σειριακή γέμισε· συνέχεια στην επόμενη επανάληψη.
+    }
+    logOffset = 0;
+    logTail = (logTail + 1) % kLogSlots;
+    logCount--;
+#if !LOG_SERIAL_TX_ROOM
+    return;
+#endif
+  }
+}
+
+uint32_t logDroppedLines() {
+  return logDropped;
+}
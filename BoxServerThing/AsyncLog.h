@@ -0,0 +1,79 @@
+/**
+ * @file AsyncLog.h
+ * @brief Μη-μπλοκάρον (non-blocking) logging για το BoxServerThing.
+ *
+ * Οι κλήσεις LOG_ERROR / LOG_WARN / LOG_INFO / LOG_DEBUG μορφοποιούν τη γραμμή
+ * σε έναν προ-δεσμευμένο κυκλικό buffer (ring buffer) και επιστρέφουν αμέσως.
+ * Η `logDrain()`, που καλείται από την `loop()`, γράφει τις γραμμές στη σειριακή
+ * θύρα μόνο όσο υπάρχει χώρος στο buffer αποστολής της, ώστε η `loop()` να μην
+ * περιμένει ποτέ τη σειριακή (9600 baud). Αν ο buffer γεμίσει, οι νέες γραμμές
+ * απορρίπτονται και μετρώνται αντί να μπλοκάρουν.
+ *
+ * Τα επίπεδα πάνω από το LOG_LEVEL δεν μεταγλωττίζονται καθόλου.
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO ///< Προεπιλεγμένο επίπεδο· ορίστε το πριν το #include για αλλαγή.
+#endif
+
+#ifndef LOG_SERIAL_TX_ROOM
+/// 1: η `Serial.availableForWrite()` του πυρήνα αναφέρει τον ελεύθερο χώρο αποστολής,
+/// οπότε 0 σημαίνει γεμάτο buffer. 0 για πυρήνα που δεν την υλοποιεί (επιστρέφει
+/// πάντα 0)· τότε η `logDrain()` γράφει μία ολόκληρη γραμμή ανά επανάληψη.
+#define LOG_SERIAL_TX_ROOM 1
+#endif
+
+/**
+ * @brief Μορφοποιεί μια γραμμή (printf-style) στον ring buffer. Δεν μπλοκάρει ποτέ.
+ * @param level Επίπεδο της γραμμής (LOG_LEVEL_ERROR ... LOG_LEVEL_DEBUG).
+ * @param format Συμβολοσειρά μορφοποίησης printf.
+ */
+void logWrite(uint8_t level, const char* format, ...);
+
+/**
+ * @brief Γράφει στη σειριακή όσες γραμμές χωρούν στο buffer αποστολής της.
+ * Πρέπει να καλείται σε κάθε επανάληψη της `loop()`.
+ */
+void logDrain();
+
+/**
+ * @brief Πλήθος γραμμών που απορρίφθηκαν επειδή ο ring buffer ήταν γεμάτος.
+ */
+uint32_t logDroppedLines();
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // ASYNC_LOG_H
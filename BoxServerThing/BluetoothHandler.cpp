@@ -11,6 +11,7 @@
 
 #include "BluetoothHandler.h" // Ορισμός της κλάσης BluetoothHandler.
 #include <WiFi.h>             // Περιλαμβάνεται για την εμφάνιση της IP διεύθυνσης στα μηνύματα σύνδεσης/αποσύνδεσης BLE.
+#include "AsyncLog.h"         // Μη-μπλοκάρον logging για τα callbacks και την αποστολή μηνυμάτων.
                               // Αυτό μπορεί να είναι χρήσιμο για debugging, για να υπάρχει γενικότερο πλαίσιο της κατάστασης του δικτύου.
 
 // Αρχικοποίηση του στατικού δείκτη 'instance'.
@@ -139,8 +140,7 @@ void BluetoothHandler::sendMessage(const String &message) {
   txCharacteristic.writeValue((const uint8_t*)formattedMessage.c_str(),
                               formattedMessage.length());
 
-  Serial.print(F("[BLE Handler] Sent TX: "));
-  Serial.println(formattedMessage);
+  LOG_INFO("[BLE Handler] Sent TX: %s", formattedMessage.c_str());
 }
 
 /**
@@ -199,10 +199,8 @@ void BluetoothHandler::onRxWrite(BLEDevice central, BLECharacteristic characteri
     // του αντικειμένου BluetoothHandler, μέσω του στατικού δείκτη 'instance'.
     instance->receivedMessage = incoming;
 
-    Serial.print(F("[BLE Handler] Received RX from ["));
-    Serial.print(central.address()); // Εκτύπωση της διεύθυνσης MAC της κεντρικής συσκευής για debugging.
-    Serial.print(F("]: "));
-    Serial.println(incoming);
+    // Εκτύπωση της διεύθυνσης MAC της κεντρικής συσκευής για debugging.
+    LOG_INFO("[BLE Handler] Received RX from [%s]: %s", central.address().c_str(), incoming.c_str());
   }
 }
 
@@ -219,15 +217,13 @@ void BluetoothHandler::onCentralConnect(BLEDevice central) {
   // Εμφάνιση πληροφοριών σύνδεσης στη σειριακή οθόνη.
   // Η εμφάνιση της IP εδώ είναι για γενικότερο logging context, καθώς η σύνδεση είναι BLE.
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.print(F("[BLE Handler] Wi-Fi Connected. IP: "));
-    Serial.println(WiFi.localIP());
+    LOG_INFO("[BLE Handler] Wi-Fi Connected. IP: %s", WiFi.localIP().toString().c_str());
   } else {
-    Serial.println(F("[BLE Handler] Wi-Fi not connected."));
+    LOG_INFO("[BLE Handler] Wi-Fi not connected.");
   }
-  Serial.print(F("[BLE Handler] Client ["));
-  Serial.print(central.address()); // Εκτύπωση της διεύθυνσης MAC του client.
-  Serial.print(F("] connected. Total connections: "));
-  Serial.println(instance->connectionCount);
+  // Εκτύπωση της διεύθυνσης MAC του client.
+  LOG_INFO("[BLE Handler] Client [%s] connected. Total connections: %d",
+           central.address().c_str(), instance->connectionCount);
 }
 
 /**
@@ -245,13 +241,11 @@ void BluetoothHandler::onCentralDisconnect(BLEDevice central) {
 
   // Εμφάνιση πληροφοριών αποσύνδεσης στη σειριακή οθόνη.
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.print(F("[BLE Handler] Wi-Fi Status: Connected. IP: "));
-    Serial.println(WiFi.localIP());
+    LOG_INFO("[BLE Handler] Wi-Fi Status: Connected. IP: %s", WiFi.localIP().toString().c_str());
   } else {
-    Serial.println(F("[BLE Handler] Wi-Fi Status: Not connected."));
+    LOG_INFO("[BLE Handler] Wi-Fi Status: Not connected.");
   }
-  Serial.print(F("[BLE Handler] Client ["));
-  Serial.print(central.address()); // Εκτύπωση της διεύθυνσης MAC του client.
-  Serial.print(F("] disconnected. Remaining connections: "));
-  Serial.println(instance->connectionCount);
+  // Εκτύπωση της διεύθυνσης MAC του client.
+  LOG_INFO("[BLE Handler] Client [%s] disconnected. Remaining connections: %d",
+           central.address().c_str(), instance->connectionCount);
 }
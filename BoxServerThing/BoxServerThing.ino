@@ -25,6 +25,7 @@
                               // Περιέχει τους ορισμούς των Cloud Variables και τη συνάρτηση initProperties().
                               // Το περιβάλλον του IoT Cloud το συγχωνεύει κατά τη μεταγλώττιση.
 #include "BluetoothHandler.h" // Προσαρμοσμένη βιβλιοθήκη για τη διαχείριση της επικοινωνίας BLE.
+#include "AsyncLog.h"         // Μη-μπλοκάρον logging (ring buffer) για τα μηνύματα της loop().
 #include <TimeLib.h>          // Βιβλιοθήκη για τη διαχείριση και μετατροπή του χρόνου.
 #include <ArduinoJson.h>      // Βιβλιοθήκη για την αποτελεσματική επεξεργασία (parsing και δημιουργία) δεδομένων JSON.
 
@@ -60,8 +61,7 @@ public:
 
     // Έλεγχος για σφάλματα κατά την αποσειριοποίηση.
     if (error) {
-      Serial.print(F("JsonHandler - JSON parse failed: ")); // Χρήση F() για εξοικονόμηση RAM
-      Serial.println(error.f_str());
+      LOG_WARN("JsonHandler - JSON parse failed: %s", error.c_str());
       return; // Έξοδος από τη συνάρτηση αν η αποσειριοποίηση απέτυχε.
     }
 
@@ -73,7 +73,7 @@ public:
       int cmd = doc["RoundStatusCommand"]["Command"] | 0;
 
       if (cmd == 1) { // Εντολή 1: Επαναφορά όλων των μεταβλητών του παιχνιδιού.
-        Serial.println(F("JsonHandler - Received RoundStatusCommand (cmd=1): Resetting all game variables."));
+        LOG_INFO("JsonHandler - Received RoundStatusCommand (cmd=1): Resetting all game variables.");
 
         // Επαναφορά των γενικών Cloud Variables που αφορούν το τελευταίο χτύπημα.
         deviceThatGotHit      = "";
@@ -93,13 +93,12 @@ public:
         redBoxer_sensorValue  = 0;
         // Οι αλλαγές στις Cloud Variables θα συγχρονιστούν με το cloud στην επόμενη κλήση ArduinoCloud.update().
       } else {
-        Serial.print(F("JsonHandler - Received RoundStatusCommand with unknown command value: "));
-        Serial.println(cmd);
+        LOG_WARN("JsonHandler - Received RoundStatusCommand with unknown command value: %d", cmd);
       }
     }
     // Αν δεν είναι "RoundStatusCommand", τότε επεξεργασία ως κανονικό μήνυμα δεδομένων χτυπήματος.
     else {
-      Serial.println(F("JsonHandler - Received punch data JSON. Parsing..."));
+      LOG_DEBUG("JsonHandler - Received punch data JSON. Parsing...");
 
       // Εξαγωγή των τιμών από τα πεδία του JSON.
       // Χρήση `doc["key"]` για πρόσβαση στις τιμές.
@@ -139,7 +138,7 @@ public:
         blueBoxer_punchCount  = punchScore; // Ο αριθμός χτυπήματος που πέτυχε ο μπλε.
         blueBoxer_timestamp   = timeStampOfThePunch; // Η χρονοσφραγίδα του χτυπήματος του μπλε.
         blueBoxer_sensorValue = sensorValue;       // Η τιμή του αισθητήρα από το χτύπημα του μπλε.
-        Serial.println(F("JsonHandler - Data attributed to BlueBoxer (hit on RedBoxer)."));
+        LOG_INFO("JsonHandler - Data attributed to BlueBoxer (hit on RedBoxer).");
       }
       else if (deviceString == "BlueBoxer") {
         // Το χτύπημα καταγράφηκε στον BlueBoxer, άρα ο RedBoxer το προκάλεσε.
@@ -147,12 +146,11 @@ public:
         redBoxer_punchCount   = punchScore; // Ο αριθμός χτυπήματος που πέτυχε ο κόκκινος.
         redBoxer_timestamp    = timeStampOfThePunch; // Η χρονοσφραγίδα του χτυπήματος του κόκκινου.
         redBoxer_sensorValue  = sensorValue;       // Η τιμή του αισθητήρα από το χτύπημα του κόκκινου.
-        Serial.println(F("JsonHandler - Data attributed to RedBoxer (hit on BlueBoxer)."));
+        LOG_INFO("JsonHandler - Data attributed to RedBoxer (hit on BlueBoxer).");
       } else if (devStr != nullptr) { // Αν το devStr υπάρχει αλλά δεν είναι "RedBoxer" ή "BlueBoxer"
-        Serial.print(F("JsonHandler - Unknown deviceStr for boxer-specific logic: "));
-        Serial.println(deviceString);
+        LOG_WARN("JsonHandler - Unknown deviceStr for boxer-specific logic: %s", deviceString.c_str());
       } else { // Αν το devStr είναι nullptr
-        Serial.println(F("JsonHandler - deviceStr is null, cannot determine specific boxer logic."));
+        LOG_WARN("JsonHandler - deviceStr is null, cannot determine specific boxer logic.");
       }
     }
   }
@@ -254,13 +252,17 @@ void loop() {
   // Η `poll()` πρέπει να καλείται τακτικά.
   bleHandler.poll();
 
+  // Εγγραφή των γραμμών log που περιμένουν στη σειριακή, χωρίς αναμονή.
+  // Τα μηνύματα των callbacks και του JsonHandler μπαίνουν σε ring buffer
+  // (βλ. AsyncLog.h) ώστε η loop() να μη σταματά στη σειριακή των 9600 baud.
+  logDrain();
+
   // Ανάγνωση τυχόν εισερχόμενου μηνύματος από τη συνδεδεμένη BLE client συσκευή.
   String incomingMessage = bleHandler.readMessage();
 
   // Έλεγχος αν υπάρχει κάποιο νέο, μη κενό μήνυμα.
   if (incomingMessage.length() > 0) {
-    Serial.print(F("[LOOP] Received raw BLE message: "));
-    Serial.println(incomingMessage);
+    LOG_DEBUG("[LOOP] Received raw BLE message: %s", incomingMessage.c_str());
 
     // Καθαρισμός του buffer του εισερχόμενου μηνύματος στον BluetoothHandler
     // ώστε να είναι έτοιμος να δεχτεί το επόμενο μήνυμα.
@@ -271,7 +273,7 @@ void loop() {
     // Μια πιο ανθεκτική προσέγγιση θα μπορούσε να περιλαμβάνει και έλεγχο για `[`
     // αν υποστηρίζονται JSON arrays ως κύρια δομή μηνύματος.
     if (incomingMessage.startsWith("{")) {
-      Serial.println(F("[LOOP] Message starts with '{', attempting JSON parse..."));
+      LOG_DEBUG("[LOOP] Message starts with '{', attempting JSON parse...");
       // Κλήση της στατικής μεθόδου parseIncoming της κλάσης JsonHandler
       // για την επεξεργασία του JSON και την ενημέρωση των Cloud Variables.
       JsonHandler::parseIncoming(incomingMessage);
@@ -289,7 +291,7 @@ void loop() {
       Serial.print(F("  redBoxer_punchCount: ")); Serial.println(redBoxer_punchCount);
       */
     } else {
-      Serial.println(F("[LOOP] Incoming message does not start with '{'. Not treated as JSON."));
+      LOG_WARN("[LOOP] Incoming message does not start with '{'. Not treated as JSON.");
     }
   }
   // Μικρή καθυστέρηση για αποφυγή υπερβολικής χρήσης CPU και για σταθερότητα, αν χρειάζεται.
@@ -0,0 +1,83 @@
+// ArduinoHal.cpp
+#include "ArduinoHal.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include "AsyncLog.h"
+
+unsigned long ArduinoClock::millis() {
+  return ::millis();
+}
+
+unsigned long ArduinoClock::micros() {
+  return ::micros();
+}
+
+uint64_t ArduinoClock::micros64() {
+  return esp_timer_get_time();
+}
+
+void SerialLogger::log(const char* line) {
+  LOG_INFO("%s", line);
+}
+
+PolledAnalogSource::PolledAnalogSource(const std::initializer_list<int>& pinList) {
+  for (auto pin : pinList) {
+    if (pins.size() < kMaxAnalogChannels) {
+      pins.push_back(pin);
+    }
+  }
+}
+
+bool PolledAnalogSource::begin() {
+  for (auto pin : pins) {
+    pinMode(pin, INPUT);
+  }
+  return true;
+}
+
+uint8_t PolledAnalogSource::channelCount() {
+  return pins.size();
+}
+
+size_t PolledAnalogSource::readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                                      uint64_t* timesUs,
+                                      size_t maxFrames) {
+  if (maxFrames == 0) {
+    return 0;
+  }
+  for (size_t ch = 0; ch < pins.size(); ch++) {
+    out[0][ch] = analogReadMilliVolts(pins[ch]);
+  }
+  timesUs[0] = esp_timer_get_time();
+  return 1;
+}
+
+HeapWatermark::HeapWatermark()
+  : markFree(0), lowestFree(0) {}
+
+void HeapWatermark::mark() {
+  markFree = lowestFree = getFree();
+}
+
+void HeapWatermark::sample() {
+  size_t freeNow = getFree();
+  if (freeNow < lowestFree) {
+    lowestFree = freeNow;
+  }
+}
+
+size_t HeapWatermark::getFree() {
+  return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+size_t HeapWatermark::getMinimumFree() {
+  return heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
+
+long HeapWatermark::getDeltaSinceMark() {
+  return (long)getFree() - (long)markFree;
+}
+
+size_t HeapWatermark::getDipSinceMark() {
+  return markFree > lowestFree ? markFree - lowestFree : 0;
+}
@@ -0,0 +1,55 @@
+// ArduinoHal.h
+// Firmware implementations of the Hal.h interfaces.
+#ifndef ARDUINO_HAL_H
+#define ARDUINO_HAL_H
+
+#include <Arduino.h>
+#include <vector>
+#include <initializer_list>
+#include "Hal.h"
+
+class ArduinoClock : public Clock {
+public:
+  unsigned long millis() override;
+  unsigned long micros() override;
+  uint64_t micros64() override;  // esp_timer
+};
+
+class SerialLogger : public Logger {
+public:
+  void log(const char* line) override;
+};
+
+// One analogReadMilliVolts() per pin per call; used when the continuous
+// ADC sampler is not available.
+class PolledAnalogSource : public AnalogSource {
+public:
+  PolledAnalogSource(const std::initializer_list<int>& pins);
+  bool begin() override;
+  uint8_t channelCount() override;
+  size_t readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                    uint64_t* timesUs,
+                    size_t maxFrames) override;
+
+private:
+  std::vector<int> pins;
+};
+
+// Free heap bookkeeping. mark() at round start, sample() from the loop;
+// a steady-state round that allocates nothing keeps delta and dip at 0.
+class HeapWatermark {
+public:
+  HeapWatermark();
+  void mark();
+  void sample();
+  size_t getFree();
+  size_t getMinimumFree();  // lowest free heap since boot
+  long getDeltaSinceMark();
+  size_t getDipSinceMark();  // largest drop below the mark
+
+private:
+  size_t markFree;
+  size_t lowestFree;
+};
+
+#endif  // ARDUINO_HAL_H
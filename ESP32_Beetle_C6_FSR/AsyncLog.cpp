@@ -0,0 +1,51 @@
+// AsyncLog.cpp
+#include "AsyncLog.h"
+#include <Arduino.h>
+#include "LogRing.h"
+
+static LogRing<32, 160> logRing;
+static TaskHandle_t logTask = nullptr;
+static uint32_t reportedDrops = 0;
+
+static const char* const kLevelPrefix[] = { "", "E ", "W ", "I ", "D " };
+
+static void logTaskEntry(void*) {
+  char line[160];
+  for (;;) {
+    size_t length;
+    while ((length = logRing.pop(line, sizeof(line))) > 0) {
+      Serial.write((const uint8_t*)line, length);
+      Serial.write('\n');
+    }
+    uint32_t drops = logRing.getDroppedLines();
+    if (drops != reportedDrops) {
+      Serial.printf("W log: %lu lines dropped\n", (unsigned long)(drops - reportedDrops));
+      reportedDrops = drops;
+    }
+    // Woken by the next line; the timeout catches lines whose producer was
+    // preempted before marking them ready.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+  }
+}
+
+void logBegin() {
+  if (logTask == nullptr) {
+    // Lowest app priority: lines go out whenever sampling, transmit and
+    // protocol tasks are all blocked, which is most of the time.
+    xTaskCreate(logTaskEntry, "log", 3072, nullptr, 1, &logTask);
+  }
+}
+
+void logWrite(uint8_t level, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  logRing.vprintf(kLevelPrefix[level <= LOG_LEVEL_DEBUG ? level : 0], format, args);
+  va_end(args);
+  if (logTask != nullptr) {
+    xTaskNotifyGive(logTask);
+  }
+}
+
+uint32_t logDroppedLines() {
+  return logRing.getDroppedLines();
+}
@@ -0,0 +1,116 @@
+// BaselineTracker.h
+#ifndef BASELINE_TRACKER_H
+#define BASELINE_TRACKER_H
+
+#include <stdint.h>
+
+// Idle level and noise floor of one pad, in fixed point (mV << 16).
+// Between hits the baseline follows slow drift (foam ageing, temperature)
+// with an integer EMA and the noise floor follows the mean absolute
+// deviation from it. A calibration window replaces both with measured
+// values. Integer math only.
+class BaselineTracker {
+public:
+  static const int kFractionBits = 16;
+  static const int kBaselineShift = 12;  // ~2 s time constant at 2 kHz
+  static const int kNoiseShift = 8;      // ~130 ms time constant at 2 kHz
+
+  BaselineTracker()
+    : baselineQ(0), noiseQ(0), calibrationSum(0), calibrationSumSq(0), calibrationCount(0), seeded(false) {}
+
+  // Feed a sample taken while the pad is idle.
+  void update(uint16_t mv) {
+    int32_t sampleQ = (int32_t)mv << kFractionBits;
+    if (!seeded) {
+      baselineQ = sampleQ;
+      seeded = true;
+      return;
+    }
+    int32_t deviationQ = sampleQ - baselineQ;
+    baselineQ += deviationQ >> kBaselineShift;
+    int32_t absDeviationQ = deviationQ < 0 ? -deviationQ : deviationQ;
+    noiseQ += (absDeviationQ - noiseQ) >> kNoiseShift;
+  }
+
+  // Feed a sample of a pad held down past its pulse (pre-load, strap
+  // tension): the baseline moves towards the held level so the pad can
+  // release and re-arm against it. The noise floor is left alone, as
+  // the gap is an offset, not noise.
+  void follow(uint16_t mv) {
+    if (!seeded) {
+      update(mv);
+      return;
+    }
+    int32_t deviationQ = ((int32_t)mv << kFractionBits) - baselineQ;
+    baselineQ += deviationQ >> kBaselineShift;
+  }
+
+  void beginCalibration() {
+    calibrationSum = 0;
+    calibrationSumSq = 0;
+    calibrationCount = 0;
+  }
+
+  void addCalibrationSample(uint16_t mv) {
+    calibrationSum += mv;
+    calibrationSumSq += (uint64_t)mv * mv;
+    calibrationCount++;
+  }
+
+  // Mean becomes the baseline; the standard deviation, scaled to the
+  // equivalent mean absolute deviation (x 0.8), becomes the noise floor.
+  void endCalibration() {
+    if (calibrationCount == 0) {
+      return;
+    }
+    uint64_t mean = calibrationSum / calibrationCount;
+    uint64_t meanSq = calibrationSumSq / calibrationCount;
+    uint64_t variance = meanSq > mean * mean ? meanSq - mean * mean : 0;
+    uint32_t deviationQ = isqrt(variance << (2 * kFractionBits));
+    baselineQ = (int32_t)((calibrationSum << kFractionBits) / calibrationCount);
+    noiseQ = (int32_t)(deviationQ * 4 / 5);
+    seeded = true;
+  }
+
+  uint16_t getBaselineMv() const {
+    return baselineQ > 0 ? (uint16_t)(baselineQ >> kFractionBits) : 0;
+  }
+
+  uint16_t getNoiseMv() const {
+    return noiseQ > 0 ? (uint16_t)((noiseQ + (1 << (kFractionBits - 1))) >> kFractionBits) : 0;
+  }
+
+  void reset() {
+    baselineQ = 0;
+    noiseQ = 0;
+    seeded = false;
+  }
+
+private:
+  static uint32_t isqrt(uint64_t value) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) {
+      bit >>= 2;
+    }
+    while (bit != 0) {
+      if (value >= result + bit) {
+        value -= result + bit;
+        result = (result >> 1) + bit;
+      } else {
+        result >>= 1;
+      }
+      bit >>= 2;
+    }
+    return (uint32_t)result;
+  }
+
+  int32_t baselineQ;
+  int32_t noiseQ;
+  uint64_t calibrationSum;
+  uint64_t calibrationSumSq;
+  uint32_t calibrationCount;
+  bool seeded;
+};
+
+#endif  // BASELINE_TRACKER_H
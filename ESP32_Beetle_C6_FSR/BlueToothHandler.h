@@ -1,38 +1,132 @@
 #ifndef BLUETOOTH_HANDLER_H
 #define BLUETOOTH_HANDLER_H
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
-#include <vector>
+#include <esp_gap_ble_api.h>
+#include <atomic>
+#include "Hal.h"
+#include "NotifyCoalescer.h"
+#include "CommandQueue.h"
+#include "Telemetry.h"
 
 #define SERVICE_UUID "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
 #define CHARACTERISTIC_UUID_RX "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
 #define CHARACTERISTIC_UUID_TX "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define CHARACTERISTIC_UUID_LINK "6E400004-B5A3-F393-E0A9-E50E24DCCA9E"
+#define CHARACTERISTIC_UUID_DIAG "6E400005-B5A3-F393-E0A9-E50E24DCCA9E"
 
-class BluetoothHandler {
+// Commands written by the app, waiting for the protocol task
+typedef CommandQueue<8, 256> RxCommandQueue;
+
+// Messages and punch frames queued by the sampling task for the transmit
+// task; one tag byte (text or binary) ahead of each record, and binary
+// records carry the time they were queued.
+typedef CommandQueue<16, 224> TxOutbox;
+
+// Connection parameters as negotiated with the current client, published
+// as JSON on the link diagnostics characteristic.
+struct LinkStats {
+  uint16_t intervalUnits;  // 1.25 ms
+  uint16_t latency;        // connection events the client may skip
+  uint16_t timeoutUnits;   // 10 ms
+  uint8_t txPhy;           // 1 = 1M, 2 = 2M, 3 = coded
+  uint8_t rxPhy;
+  uint16_t txOctets;       // LL payload after data length extension
+  uint16_t rxOctets;
+  uint16_t mtu;
+  bool lowLatency;         // round profile requested
+};
+
+class BluetoothHandler : public Transport {
 public:
   BluetoothHandler();
   void begin(const char* deviceName);
-  void sendMessage(const String& message);
-  String readMessage();
-  void clearMessage();
-  bool isDeviceConnected();
+  // Starts the task that owns the TX characteristic: it drains the outbox
+  // and sends coalesced batches when their delay runs out.
+  void startTransmitTask(UBaseType_t priority);
+  // Task woken (xTaskNotifyGive) when a command arrives or a client
+  // connects or disconnects.
+  void setCommandListener(TaskHandle_t task);
+
+  // Direct sends: may block until the stack accepts the notification, so
+  // never call them from the sampling task.
+  void sendMessage(const char* message) override;
+  // Binary records are coalesced into one notification (see
+  // NotifyCoalescer); text messages flush them first and go out at once.
+  void sendBytes(const uint8_t* data, size_t length) override;
+  void flushPending();
+  // Bulk transfers (journal download): one notification holding exactly
+  // these bytes, after anything pending. getPayloadLimit() is what fits.
+  void sendChunk(const uint8_t* data, size_t length);
+  size_t getPayloadLimit();
+
+  // Queued sends for the sampling task (single producer): copy into the
+  // outbox and wake the transmit task, never touch the radio. Return false
+  // when the outbox is full.
+  bool queueMessage(const char* message);
+  bool queueBytes(const uint8_t* data, size_t length);
+  uint32_t getDroppedOutbound();
+
+  // Health telemetry: queued punch frame -> notification latency, failed
+  // notifications (GATT errors), notifications skipped because no client
+  // was connected or subscribed, commands waiting.
+  void copyNotifyLatency(LatencyHistogram& out, bool reset);
+  uint32_t getNotifyFailures();
+  uint32_t getNotifySkipped();
+  size_t getPendingCommands();
+  // Read value and notification of the diagnostics characteristic
+  void publishDiagnostics(const char* json);
+
+  void setCoalesceDelayMs(uint32_t delayMs);
+  // Short connection interval while a round runs, relaxed otherwise.
+  void setLowLatency(bool enabled);
+  LinkStats getLinkStats();  // copy, taken under statsLock
+  // Copies the oldest pending command into out; returns its length, 0 when
+  // none is waiting. receivedUs is when the write arrived (esp_timer).
+  size_t readCommand(char* out, size_t outSize, uint64_t& receivedUs);
+  uint32_t getDroppedCommands();
+  uint32_t getOversizedCommands();
+  bool isDeviceConnected() override;
+  // Standby turns advertising off while the chip sleeps
+  void setAdvertising(bool enabled);
 
 private:
   BLEServer* pServer;
   BLECharacteristic* pTxCharacteristic;
   BLECharacteristic* pRxCharacteristic;
-  std::vector<uint16_t> connectedClients;
-  String receivedMessage;
+  BLECharacteristic* pLinkCharacteristic;
+  BLECharacteristic* pDiagCharacteristic;
+  // Written by the BLE callbacks, read by every task (isDeviceConnected)
+  std::atomic<bool> hasPeer;
+  esp_bd_addr_t peerAddress;        // guarded by statsLock
+  LinkStats linkStats;              // guarded by statsLock
+  SemaphoreHandle_t statsLock;
+  RxCommandQueue commands;
+  TxOutbox outbox;
+  NotifyCoalescer coalescer;        // guarded by sendLock
+  SemaphoreHandle_t sendLock;       // TX characteristic, coalescer, outbox consumer side
+  TaskHandle_t transmitTask;
+  TaskHandle_t commandListener;
+  // Set by the BLE callbacks, applied to the coalescer under sendLock
+  std::atomic<uint16_t> negotiatedMtu;
+  std::atomic<bool> linkReset;
+  LatencyHistogram notifyLatency;   // guarded by sendLock
+  std::atomic<uint32_t> notifyFailures;
+  std::atomic<uint32_t> notifySkipped;
 
   class ServerCallbacks : public BLEServerCallbacks {
     BluetoothHandler* parent;
   public:
     ServerCallbacks(BluetoothHandler* parentInstance);
     void onConnect(BLEServer* pServer) override;
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
     void onDisconnect(BLEServer* pServer) override;
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
   };
 
   class RxCallbacks : public BLECharacteristicCallbacks {
@@ -42,9 +136,29 @@ private:
     void onWrite(BLECharacteristic* pCharacteristic) override;
   };
 
+  // Counts notifications the stack refused: GATT errors as failures, no
+  // client / not subscribed apart, as those only mean the app is away
+  class TxCallbacks : public BLECharacteristicCallbacks {
+    BluetoothHandler* parent;
+  public:
+    TxCallbacks(BluetoothHandler* parentInstance);
+    void onStatus(BLECharacteristic* pCharacteristic, Status s, uint32_t code) override;
+  };
+
   ServerCallbacks serverCallbacks;
   RxCallbacks rxCallbacks;
-  void cleanDisconnectedClients();
+  TxCallbacks txCallbacks;
+  void requestConnParams();
+  void publishLinkStats();
+  bool queueRecord(uint8_t tag, const uint8_t* data, size_t length);
+  void drainOutbox();   // sendLock held
+  void appendLocked(const uint8_t* data, size_t length, uint64_t queuedUs);  // sendLock held
+  void flushLocked();   // sendLock held
+  void sendLocked(const char* message, size_t length);  // sendLock held
+  void transmitLoop();
+  static void transmitTaskEntry(void* arg);
+  static void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+  static BluetoothHandler* instance;  // target of the GAP callback
 };
 
 #endif  // BLUETOOTH_HANDLER_H
\ No newline at end of file
@@ -1,17 +1,51 @@
 #include "BluetoothHandler.h"
 #include "esp_gap_ble_api.h"  // For security parameters if needed
 #include <string.h>
+#include <esp_timer.h>
+#include "AsyncLog.h"
+
+// Connection interval ranges (1.25 ms units), latency and supervision
+// timeout (10 ms units) requested from the client.
+static const uint16_t kRoundMinInterval = 6;    // 7.5 ms
+static const uint16_t kRoundMaxInterval = 12;   // 15 ms
+static const uint16_t kRoundLatency = 0;
+static const uint16_t kIdleMinInterval = 40;    // 50 ms
+static const uint16_t kIdleMaxInterval = 80;    // 100 ms
+static const uint16_t kIdleLatency = 4;
+static const uint16_t kSupervisionTimeout = 400;  // 4 s
+static const uint16_t kMaxTxOctets = 251;
+
+// Outbox record tags
+static const uint8_t kRecordText = 'T';
+static const uint8_t kRecordBytes = 'B';
+
+BluetoothHandler* BluetoothHandler::instance = nullptr;
 
 BluetoothHandler::BluetoothHandler()
   : pServer(nullptr), pTxCharacteristic(nullptr), pRxCharacteristic(nullptr),
-    serverCallbacks(this), rxCallbacks(this) {}
+    pLinkCharacteristic(nullptr), pDiagCharacteristic(nullptr), hasPeer(false), linkStats(),
+    statsLock(nullptr), sendLock(nullptr), transmitTask(nullptr), commandListener(nullptr),
+    negotiatedMtu(0), linkReset(false), notifyFailures(0), notifySkipped(0),
+    serverCallbacks(this), rxCallbacks(this), txCallbacks(this) {
+  instance = this;
+}
 
 void BluetoothHandler::begin(const char* deviceName) {
+  if (sendLock == nullptr) {
+    sendLock = xSemaphoreCreateMutex();
+  }
+  if (statsLock == nullptr) {
+    statsLock = xSemaphoreCreateMutex();
+  }
+
   // Initialize BLE with the given device name.
   BLEDevice::init(deviceName);
 
   // Set MTU to a value more compatible with Android devices.
   BLEDevice::setMTU(247);
+  // Prefer LE 2M PHY for every connection; the client may still refuse.
+  esp_ble_gap_set_preferred_default_phy(ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK);
+  BLEDevice::setCustomGapHandler(onGapEvent);
 
   pServer = BLEDevice::createServer();
   pServer->setCallbacks(&serverCallbacks);
@@ -24,6 +58,7 @@ void BluetoothHandler::begin(const char* deviceName) {
   BLE2902* p2902 = new BLE2902();
   p2902->setAccessPermissions(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
   pTxCharacteristic->addDescriptor(p2902);
+  pTxCharacteristic->setCallbacks(&txCallbacks);
 
   // Create RX characteristic with write and read properties.
   pRxCharacteristic = pService->createCharacteristic(
@@ -31,40 +66,349 @@ void BluetoothHandler::begin(const char* deviceName) {
   pRxCharacteristic->setAccessPermissions(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
   pRxCharacteristic->setCallbacks(&rxCallbacks);
 
+  // Link diagnostics: negotiated interval, PHY, data length and MTU.
+  pLinkCharacteristic = pService->createCharacteristic(
+    CHARACTERISTIC_UUID_LINK, BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+  pLinkCharacteristic->addDescriptor(new BLE2902());
+  publishLinkStats();
+
+  // Health telemetry: a summary to read, histograms notified on request.
+  pDiagCharacteristic = pService->createCharacteristic(
+    CHARACTERISTIC_UUID_DIAG, BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+  pDiagCharacteristic->addDescriptor(new BLE2902());
+  pDiagCharacteristic->setValue("{}");
+
   pService->start();
 
   // Enable scan response to include the device name.
   BLEAdvertising* pAdvertising = pServer->getAdvertising();
   pAdvertising->setScanResponse(true);
   pAdvertising->start();
-  Serial.println("Waiting for client connections...");
+  LOG_INFO("Waiting for client connections...");
 }
 
-void BluetoothHandler::sendMessage(const String& message) {
-  pTxCharacteristic->setValue(message.c_str());
-  pTxCharacteristic->notify();                 // Using notify without connection id.
-  Serial.println("Sent Message: " + message);  // Print the message that is sending in terminal
+void BluetoothHandler::startTransmitTask(UBaseType_t priority) {
+  if (transmitTask == nullptr) {
+    xTaskCreate(transmitTaskEntry, "bleTx", 4096, this, priority, &transmitTask);
+  }
 }
 
-String BluetoothHandler::readMessage() {
-  return receivedMessage;
+void BluetoothHandler::setCommandListener(TaskHandle_t task) {
+  commandListener = task;
 }
 
-void BluetoothHandler::clearMessage() {
-  receivedMessage = "";
+void BluetoothHandler::sendMessage(const char* message) {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  drainOutbox();  // queued punches went first
+  sendLocked(message, strlen(message));
+  xSemaphoreGive(sendLock);
 }
 
-bool BluetoothHandler::isDeviceConnected() {
-  return !connectedClients.empty();
+void BluetoothHandler::sendBytes(const uint8_t* data, size_t length) {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  drainOutbox();
+  appendLocked(data, length, esp_timer_get_time());
+  xSemaphoreGive(sendLock);
+  if (transmitTask != nullptr) {
+    xTaskNotifyGive(transmitTask);  // times the coalescing delay
+  }
+}
+
+void BluetoothHandler::flushPending() {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  drainOutbox();
+  flushLocked();
+  xSemaphoreGive(sendLock);
+}
+
+void BluetoothHandler::sendChunk(const uint8_t* data, size_t length) {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  drainOutbox();
+  flushLocked();
+  pTxCharacteristic->setValue(const_cast<uint8_t*>(data), length);
+  pTxCharacteristic->notify();
+  xSemaphoreGive(sendLock);
+}
+
+size_t BluetoothHandler::getPayloadLimit() {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  drainOutbox();  // applies a newly negotiated MTU
+  size_t limit = coalescer.getPayloadLimit();
+  xSemaphoreGive(sendLock);
+  return limit;
+}
+
+bool BluetoothHandler::queueMessage(const char* message) {
+  return queueRecord(kRecordText, (const uint8_t*)message, strlen(message));
+}
+
+bool BluetoothHandler::queueBytes(const uint8_t* data, size_t length) {
+  return queueRecord(kRecordBytes, data, length);
+}
+
+uint32_t BluetoothHandler::getDroppedOutbound() {
+  return outbox.getDroppedCommands() + outbox.getOversizedCommands();
+}
+
+bool BluetoothHandler::queueRecord(uint8_t tag, const uint8_t* data, size_t length) {
+  uint8_t record[TxOutbox::kSlotSize];
+  size_t header = 1;
+  record[0] = tag;
+  if (tag == kRecordBytes) {
+    uint64_t queuedUs = esp_timer_get_time();  // start of the notify latency
+    memcpy(record + 1, &queuedUs, sizeof(queuedUs));
+    header += sizeof(queuedUs);
+  }
+  size_t size = length + header;
+  if (size < sizeof(record)) {
+    memcpy(record + header, data, length);
+  }
+  bool queued = outbox.push((const char*)record, size);  // counts full and oversized
+  if (transmitTask != nullptr) {
+    xTaskNotifyGive(transmitTask);
+  }
+  return queued;
+}
+
+void BluetoothHandler::drainOutbox() {
+  if (linkReset.exchange(false)) {
+    coalescer.clear();
+    coalescer.setPayloadLimit(NotifyCoalescer::kDefaultPayload);
+  }
+  uint16_t mtu = negotiatedMtu.exchange(0);
+  if (mtu != 0) {
+    coalescer.setPayloadLimit(mtu - 3);
+  }
+
+  uint8_t record[TxOutbox::kSlotSize];
+  size_t size;
+  while ((size = outbox.pop((char*)record, sizeof(record))) > 0) {
+    if (record[0] == kRecordText) {
+      sendLocked((const char*)record + 1, size - 1);
+    } else if (size > 1 + sizeof(uint64_t)) {
+      uint64_t queuedUs;
+      memcpy(&queuedUs, record + 1, sizeof(queuedUs));
+      appendLocked(record + 1 + sizeof(queuedUs), size - 1 - sizeof(queuedUs), queuedUs);
+    }
+  }
+}
+
+// The batch delay runs from when the oldest record was queued.
+void BluetoothHandler::appendLocked(const uint8_t* data, size_t length, uint64_t queuedUs) {
+  uint64_t now = esp_timer_get_time();
+  if (!coalescer.append(data, length, queuedUs)) {
+    flushLocked();
+    if (!coalescer.append(data, length, queuedUs)) {
+      return;  // larger than one notification
+    }
+  }
+  if (coalescer.isDue(now)) {
+    flushLocked();
+  }
+}
+
+void BluetoothHandler::flushLocked() {
+  if (coalescer.empty()) {
+    return;
+  }
+  pTxCharacteristic->setValue(const_cast<uint8_t*>(coalescer.data()), coalescer.size());
+  pTxCharacteristic->notify();
+  notifyLatency.record((uint32_t)(esp_timer_get_time() - coalescer.getFirstUs()));
+  LOG_DEBUG("Sent frames: %u bytes", (unsigned)coalescer.size());
+  coalescer.clear();
 }
 
-void BluetoothHandler::cleanDisconnectedClients() {
-  connectedClients.erase(
-    std::remove_if(connectedClients.begin(), connectedClients.end(),
-                   [&](uint16_t handle) {
-                     return pServer->getConnectedCount() == 0;
-                   }),
-    connectedClients.end());
+void BluetoothHandler::sendLocked(const char* message, size_t length) {
+  flushLocked();  // keep punches ahead of the control message that follows them
+  // Raw bytes: setValue(const char*) would build a temporary String
+  pTxCharacteristic->setValue((uint8_t*)message, length);
+  pTxCharacteristic->notify();  // Using notify without connection id.
+  LOG_INFO("Sent Message: %.*s", (int)length, message);  // Print the message that is sending in terminal
+}
+
+void BluetoothHandler::transmitTaskEntry(void* arg) {
+  static_cast<BluetoothHandler*>(arg)->transmitLoop();
+}
+
+// Sleeps until something is queued, or until the open batch is due.
+void BluetoothHandler::transmitLoop() {
+  for (;;) {
+    TickType_t wait = portMAX_DELAY;
+    xSemaphoreTake(sendLock, portMAX_DELAY);
+    drainOutbox();
+    uint64_t now = esp_timer_get_time();
+    if (coalescer.isDue(now)) {
+      flushLocked();
+    }
+    if (!coalescer.empty()) {
+      wait = pdMS_TO_TICKS((coalescer.dueInUs(now) + 999) / 1000);
+      if (wait == 0) {
+        wait = 1;
+      }
+    }
+    xSemaphoreGive(sendLock);
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+void BluetoothHandler::setCoalesceDelayMs(uint32_t delayMs) {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  coalescer.setMaxDelayUs(delayMs * 1000);
+  xSemaphoreGive(sendLock);
+  if (transmitTask != nullptr) {
+    xTaskNotifyGive(transmitTask);  // re-times an open batch against the new delay
+  }
+}
+
+void BluetoothHandler::setAdvertising(bool enabled) {
+  if (pServer == nullptr) {
+    return;
+  }
+  if (enabled) {
+    pServer->getAdvertising()->start();
+  } else {
+    pServer->getAdvertising()->stop();
+  }
+}
+
+void BluetoothHandler::copyNotifyLatency(LatencyHistogram& out, bool reset) {
+  xSemaphoreTake(sendLock, portMAX_DELAY);
+  out = notifyLatency;
+  if (reset) {
+    notifyLatency.reset();
+  }
+  xSemaphoreGive(sendLock);
+}
+
+uint32_t BluetoothHandler::getNotifyFailures() {
+  return notifyFailures.load(std::memory_order_relaxed);
+}
+
+uint32_t BluetoothHandler::getNotifySkipped() {
+  return notifySkipped.load(std::memory_order_relaxed);
+}
+
+size_t BluetoothHandler::getPendingCommands() {
+  return commands.pending();
+}
+
+void BluetoothHandler::publishDiagnostics(const char* json) {
+  if (pDiagCharacteristic == nullptr) {
+    return;
+  }
+  pDiagCharacteristic->setValue((uint8_t*)json, strlen(json));
+  if (hasPeer) {
+    pDiagCharacteristic->notify();
+  }
+}
+
+size_t BluetoothHandler::readCommand(char* out, size_t outSize, uint64_t& receivedUs) {
+  return commands.pop(out, outSize, &receivedUs);
+}
+
+uint32_t BluetoothHandler::getDroppedCommands() {
+  return commands.getDroppedCommands();
+}
+
+uint32_t BluetoothHandler::getOversizedCommands() {
+  return commands.getOversizedCommands();
+}
+
+void BluetoothHandler::setLowLatency(bool enabled) {
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  bool changed = linkStats.lowLatency != enabled;
+  linkStats.lowLatency = enabled;
+  xSemaphoreGive(statsLock);
+  if (!changed) {
+    return;
+  }
+  requestConnParams();
+  publishLinkStats();
+}
+
+LinkStats BluetoothHandler::getLinkStats() {
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  LinkStats stats = linkStats;
+  xSemaphoreGive(statsLock);
+  return stats;
+}
+
+void BluetoothHandler::requestConnParams() {
+  if (!hasPeer) {
+    return;
+  }
+  esp_bd_addr_t address;
+  xSemaphoreTake(statsLock, portMAX_DELAY);
+  memcpy(address, peerAddress, sizeof(esp_bd_addr_t));
+  bool lowLatency = linkStats.lowLatency;
+  xSemaphoreGive(statsLock);
+  if (lowLatency) {
+    pServer->updateConnParams(address, kRoundMinInterval, kRoundMaxInterval, kRoundLatency, kSupervisionTimeout);
+  } else {
+    pServer->updateConnParams(address, kIdleMinInterval, kIdleMaxInterval, kIdleLatency, kSupervisionTimeout);
+  }
+}
+
+void BluetoothHandler::publishLinkStats() {
+  if (pLinkCharacteristic == nullptr) {
+    return;
+  }
+  LinkStats linkStats = getLinkStats();
+  char json[160];
+  snprintf(json, sizeof(json),
+           "{\"IntervalUs\":%u,\"Latency\":%u,\"TimeoutMs\":%u,\"TxPhy\":%u,\"RxPhy\":%u,"
+           "\"TxOctets\":%u,\"RxOctets\":%u,\"MTU\":%u,\"Profile\":\"%s\"}",
+           (unsigned)linkStats.intervalUnits * 1250, (unsigned)linkStats.latency,
+           (unsigned)linkStats.timeoutUnits * 10, (unsigned)linkStats.txPhy, (unsigned)linkStats.rxPhy,
+           (unsigned)linkStats.txOctets, (unsigned)linkStats.rxOctets, (unsigned)linkStats.mtu,
+           linkStats.lowLatency ? "Round" : "Idle");
+  pLinkCharacteristic->setValue(json);
+  if (hasPeer) {
+    pLinkCharacteristic->notify();
+  }
+}
+
+void BluetoothHandler::onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  BluetoothHandler* self = instance;
+  if (self == nullptr) {
+    return;
+  }
+  switch (event) {
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+      if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+        xSemaphoreTake(self->statsLock, portMAX_DELAY);
+        self->linkStats.intervalUnits = param->update_conn_params.conn_int;
+        self->linkStats.latency = param->update_conn_params.latency;
+        self->linkStats.timeoutUnits = param->update_conn_params.timeout;
+        xSemaphoreGive(self->statsLock);
+        self->publishLinkStats();
+      }
+      break;
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+      if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+        xSemaphoreTake(self->statsLock, portMAX_DELAY);
+        self->linkStats.txPhy = param->phy_update.tx_phy;
+        self->linkStats.rxPhy = param->phy_update.rx_phy;
+        xSemaphoreGive(self->statsLock);
+        self->publishLinkStats();
+      }
+      break;
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+      if (param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+        xSemaphoreTake(self->statsLock, portMAX_DELAY);
+        self->linkStats.txOctets = param->pkt_data_length_cmpl.params.tx_len;
+        self->linkStats.rxOctets = param->pkt_data_length_cmpl.params.rx_len;
+        xSemaphoreGive(self->statsLock);
+        self->publishLinkStats();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+bool BluetoothHandler::isDeviceConnected() {
+  return hasPeer;
 }
 
 // ----------------------- Server Callbacks -----------------------
@@ -73,28 +417,103 @@ BluetoothHandler::ServerCallbacks::ServerCallbacks(BluetoothHandler* parentInsta
   : parent(parentInstance) {}
 
 void BluetoothHandler::ServerCallbacks::onConnect(BLEServer* pServer) {
-  // You may not have direct access to a connection ID with this signature.
-  // For now, we simply note a connection has been made.
-  parent->connectedClients.push_back(1);  // Dummy ID; adjust as needed.
-  Serial.println("Device connected. Total connections: " + String(parent->connectedClients.size()));
+  // hasPeer and the peer address are set by the overload with the connect parameters
+  LOG_INFO("Device connected. Total connections: %u", (unsigned)pServer->getConnectedCount());
   parent->pTxCharacteristic->setValue("");
   parent->pTxCharacteristic->notify();
 }
 
+void BluetoothHandler::ServerCallbacks::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+  // Remember the client so the link profile can be renegotiated later
+  xSemaphoreTake(parent->statsLock, portMAX_DELAY);
+  memcpy(parent->peerAddress, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+  parent->linkStats.intervalUnits = param->connect.conn_params.interval;
+  parent->linkStats.latency = param->connect.conn_params.latency;
+  parent->linkStats.timeoutUnits = param->connect.conn_params.timeout;
+  parent->linkStats.txPhy = parent->linkStats.rxPhy = 1;
+  parent->linkStats.txOctets = parent->linkStats.rxOctets = 27;
+  parent->linkStats.mtu = 23;
+  xSemaphoreGive(parent->statsLock);
+  parent->hasPeer = true;
+
+  esp_ble_gap_set_preferred_phy(param->connect.remote_bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+  esp_ble_gap_set_pkt_data_len(param->connect.remote_bda, kMaxTxOctets);
+  parent->requestConnParams();
+  if (parent->commandListener != nullptr) {
+    xTaskNotifyGive(parent->commandListener);
+  }
+}
+
 void BluetoothHandler::ServerCallbacks::onDisconnect(BLEServer* pServer) {
-  parent->connectedClients.clear();
+  parent->hasPeer = false;
+  parent->linkReset = true;
+  if (parent->transmitTask != nullptr) {
+    xTaskNotifyGive(parent->transmitTask);
+  }
+  if (parent->commandListener != nullptr) {
+    xTaskNotifyGive(parent->commandListener);
+  }
   delay(150);
-  Serial.println("Device disconnected. Remaining connections: " + String(parent->connectedClients.size()));
+  LOG_INFO("Device disconnected. Remaining connections: %u", (unsigned)pServer->getConnectedCount());
   pServer->startAdvertising();
 }
 
+void BluetoothHandler::ServerCallbacks::onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+  parent->negotiatedMtu = param->mtu.mtu;
+  if (parent->transmitTask != nullptr) {
+    xTaskNotifyGive(parent->transmitTask);
+  }
+  xSemaphoreTake(parent->statsLock, portMAX_DELAY);
+  parent->linkStats.mtu = param->mtu.mtu;
+  xSemaphoreGive(parent->statsLock);
+  parent->publishLinkStats();
+  LOG_INFO("MTU changed: %u", (unsigned)param->mtu.mtu);
+}
+
 // ----------------------- RX Callbacks -----------------------
 
+BluetoothHandler::TxCallbacks::TxCallbacks(BluetoothHandler* parentInstance)
+  : parent(parentInstance) {}
+
+void BluetoothHandler::TxCallbacks::onStatus(BLECharacteristic* pCharacteristic, Status s, uint32_t code) {
+  switch (s) {
+    case SUCCESS_NOTIFY:
+    case SUCCESS_INDICATE:
+      break;
+    case ERROR_GATT:
+    case ERROR_INDICATE_TIMEOUT:
+    case ERROR_INDICATE_FAILURE:
+      parent->notifyFailures.fetch_add(1, std::memory_order_relaxed);
+      break;
+    default:  // no client, notifications not enabled / no subscriber
+      parent->notifySkipped.fetch_add(1, std::memory_order_relaxed);
+      break;
+  }
+}
+
 BluetoothHandler::RxCallbacks::RxCallbacks(BluetoothHandler* parentInstance)
   : parent(parentInstance) {}
 
 void BluetoothHandler::RxCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
-  parent->receivedMessage = pCharacteristic->getValue().c_str();
-  parent->receivedMessage.trim();
-  Serial.println("Received message: " + parent->receivedMessage);
+  uint64_t receivedUs = esp_timer_get_time();  // T2 of a ClockSync exchange
+  const char* data = (const char*)pCharacteristic->getData();
+  size_t length = pCharacteristic->getLength();
+  // Trim surrounding whitespace without copying
+  while (length > 0 && isspace((unsigned char)data[0])) {
+    data++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)data[length - 1])) {
+    length--;
+  }
+  if (length == 0) {
+    return;
+  }
+  if (!parent->commands.push(data, length, receivedUs)) {
+    LOG_WARN("Command dropped: queue full or too long");
+  }
+  if (parent->commandListener != nullptr) {
+    xTaskNotifyGive(parent->commandListener);
+  }
 }
@@ -1,184 +1,931 @@
 #include "BoxingApp.h"
 #include <ArduinoJson.h>
-#include <BLEDevice.h>
-#include "MacDevicesConfig.h"  // mac address store header
+#include "DeviceRole.h"
+#include "ForceStore.h"
+#include "AsyncLog.h"
 
-String DEVICE_NAME = "";  // Global variable for device name
+const char* DEVICE_NAME = "UnknownDevice";  // Global device name; points at a literal, never copied
+
+// Task priorities, highest first: the FsrSampler ADC drain (5) and the
+// sampling task keep detection ahead of BLE traffic; the transmit task
+// sends what they queue; commands, then logging and the flash journal (1)
+// run last.
+static const UBaseType_t kSamplingPriority = 4;
+static const UBaseType_t kTransmitPriority = 3;
+static const UBaseType_t kProtocolPriority = 2;
+static const UBaseType_t kJournalPriority = 1;
+
+// FsrSampler wakes the sampling task after every DMA batch; the timeout
+// keeps the round timer running should the ADC stall. Polled reads take
+// one frame per tick.
+static const TickType_t kAdcWaitTicks = pdMS_TO_TICKS(10);
+static const TickType_t kPolledWaitTicks = 1;
+
+// While a client is connected the diagnostics summary is refreshed this
+// often.
+static const TickType_t kDiagnosticsTicks = pdMS_TO_TICKS(5000);
+static const uint64_t kDiagnosticsPeriodUs = 5000000ULL;
+
+// Standby: the sensor sleeps in slices of kStandbySliceUs and advertises
+// for kStandbyAdvertiseTicks between them, so the app still finds it
+// within a few seconds. After a hit the detector gets kWakeWindowUs to
+// see the punch.
+static const uint64_t kStandbyIdleUs = 120000000ULL;
+static const uint64_t kStandbySliceUs = 3000000ULL;
+static const TickType_t kStandbyAdvertiseTicks = pdMS_TO_TICKS(400);
+static const uint64_t kWakeWindowUs = 5000000ULL;
+
+// Holds the app state lock for one scope.
+class StateGuard {
+public:
+  explicit StateGuard(SemaphoreHandle_t stateLock)
+    : lock(stateLock) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+  }
+  ~StateGuard() {
+    xSemaphoreGive(lock);
+  }
+
+private:
+  SemaphoreHandle_t lock;
+};
 
 BoxingApp::BoxingApp()
-  : startReading(false),
-    roundTime(180000),
-    breakTime(60000),
+  : commandDepth(1),
+    heapFree(16384),
+    lastDiagnosticsUs(0),
+    standbyIdleUs(kStandbyIdleUs),
+    idleSinceUs(0),
+    awaitingWakePunch(false),
+    impactWakeUs(0),
+    streamingWaveform(false),
+    waveformStopPending(false),
+    waveformAdcDropped(0),
+    samplingTask(nullptr),
+    protocolTask(nullptr),
+    stateLock(nullptr),
+    adcSampling(false),
+    samplingActive(false),
     fsrSensitivity(800),
     fsrThreshold(200),
-    isPaused(false),
-    elapsedTime(0),
-    command(0),
-    roundActive(false),
-    lastSentPunch(""),
-    duplicatePunchCount(0)  // Initialize duplicate counter
+    sampleRateHz(2000),
+    calibrating(false),
+    binaryPunches(false)
 {
   bluetoothHandler = new BluetoothHandler();
   // fsrHandler = new FSRPunchDetector(6, fsrSensitivity);
-  // new: watch pins 4, 5, and 6
-  fsrHandler = new FSRPunchDetector({ 4, 5, 6 },
-                                    fsrSensitivity,
-                                    fsrThreshold);
+  // new: watch the pads of FSR_PAD_PINS (4, 5 and 6 by default)
+  fsrHandler = new PadPunchDetector(fsrSensitivity, fsrThreshold);
+  fsrSampler = new FsrSampler({ FSR_PAD_PINS }, sampleRateHz);
+  polledSource = new PolledAnalogSource({ FSR_PAD_PINS });
+  analogSource = polledSource;
+  sleepHandler = new SleepHandler({ FSR_PAD_PINS });
 
-  timeHandler = new TimeHandler();
+  timeHandler = new TimeHandler(clock);
+  roundController = new RoundController(*timeHandler, 180000, 60000);
 }
 
 void BoxingApp::setup() {
   Serial.begin(115200);
+  logBegin();
+  stateLock = xSemaphoreCreateMutex();
 
-  // Initialize BLE and get BLE address
-  BLEDevice::init("");
-  String bleAddress = BLEDevice::getAddress().toString().c_str();
-  Serial.print("BLE Address: ");
-  Serial.println(bleAddress.c_str());
-
-  // Default device name; adjust as needed by checking your MAC lists
-  DEVICE_NAME = "UnknownDevice";
-  for (int i = 0; i < NUM_BLUEBOXER_MACS; i++) {
-    if (bleAddress.equalsIgnoreCase(BLUEBOXER_MACS[i])) {
-      DEVICE_NAME = "BlueBoxer";
-      break;
+  // Role from NVS (or the MAC table on first boot): BLE comes up once,
+  // already under its final name
+  DEVICE_NAME = punchDeviceName(loadDeviceRole());
+
+  bluetoothHandler->begin(DEVICE_NAME);  // Start BLE with your device name
+  fsrHandler->setDeviceName(DEVICE_NAME);
+  loadForceCurves(*fsrHandler);
+  if (fsrSampler->begin()) {
+    adcSampling = true;
+    fsrSampler->end();  // runs only during rounds and calibration, see updateSampler()
+    analogSource = fsrSampler;
+    fsrHandler->setup(fsrSampler, &logger);
+  } else {
+    LOG_WARN("Falling back to polled FSR reads.");
+    polledSource->begin();
+    fsrHandler->setup(polledSource, &logger);
+  }
+
+  if (journal.begin()) {
+    journal.startWriterTask(kJournalPriority);
+  }
+
+  // Every task blocks until it has work: sampling on the ADC, protocol on
+  // an incoming command or a (dis)connect, transmit on queued output.
+  xTaskCreate(samplingTaskEntry, "sampling", 4096, this, kSamplingPriority, &samplingTask);
+  xTaskCreate(protocolTaskEntry, "protocol", 6144, this, kProtocolPriority, &protocolTask);
+  fsrSampler->setListener(samplingTask);
+  bluetoothHandler->setCommandListener(protocolTask);
+  bluetoothHandler->startTransmitTask(kTransmitPriority);
+
+  LOG_INFO("%s BLE Device is Ready  BoxingApp is ready after %lu ms", DEVICE_NAME, millis());
+  LOG_INFO("Waiting for client connections...");
+}
+
+void BoxingApp::loop() {
+  // All work runs in the tasks started by setup(); the Arduino loop task
+  // would only spin.
+  vTaskDelete(nullptr);
+}
+
+void BoxingApp::samplingTaskEntry(void* arg) {
+  BoxingApp* app = static_cast<BoxingApp*>(arg);
+  for (;;) {
+    TickType_t wait;
+    {
+      StateGuard guard(app->stateLock);
+      uint64_t startUs = app->clock.micros64();
+      wait = app->processSamples();
+      if (app->samplingActive) {
+        app->loopUs.record((uint32_t)(app->clock.micros64() - startUs));
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+void BoxingApp::protocolTaskEntry(void* arg) {
+  BoxingApp* app = static_cast<BoxingApp*>(arg);
+  for (;;) {
+    app->commandDepth.record(app->bluetoothHandler->getPendingCommands());
+    app->handleCommands();
+    app->updateLink();
+    app->updateDiagnostics();
+    app->sendWaveform();
+    TickType_t wait = app->bluetoothHandler->isDeviceConnected() ? kDiagnosticsTicks : portMAX_DELAY;
+    TickType_t standby = app->updateStandby();
+    ulTaskNotifyTake(pdTRUE, standby < wait ? standby : wait);
+  }
+}
+
+TickType_t BoxingApp::processSamples() {
+  TickType_t sampleWait = adcSampling ? kAdcWaitTicks : kPolledWaitTicks;
+
+  // A round or calibration takes the samples back from the raw stream
+  if (streamingWaveform) {
+    if (!calibrating && !roundController->isDetecting()) {
+      return streamWaveform();
+    }
+    stopWaveformLocked();
+  }
+
+  // Calibration runs the detector on idle pads, independent of the round
+  if (calibrating) {
+    fsrHandler->checkPunch();
+    if (!fsrHandler->isCalibrating()) {
+      calibrating = false;
+      sendCalibrationResult();
+      updateSampler();
+    }
+    return samplingActive ? sampleWait : portMAX_DELAY;
+  }
+
+  // Woken from standby by a hit outside a round: run the detector until
+  // it sees that punch, for the wake-to-punch latency only
+  if (awaitingWakePunch && !roundController->isDetecting()) {
+    if (fsrHandler->checkPunch()) {
+      recordWakePunch();
+    } else if (clock.micros64() - impactWakeUs >= kWakeWindowUs) {
+      LOG_INFO("Standby wake: no punch within %lu ms.", (unsigned long)(kWakeWindowUs / 1000ULL));
+      awaitingWakePunch = false;
+      updateSampler();
     }
+    return samplingActive ? sampleWait : portMAX_DELAY;
   }
-  if (DEVICE_NAME.equals("UnknownDevice")) {
-    for (int i = 0; i < NUM_REDBOXER_MACS; i++) {
-      if (bleAddress.equalsIgnoreCase(REDBOXER_MACS[i])) {
-        DEVICE_NAME = "RedBoxer";
-        break;
+
+  // If the round is active and not paused, check for punches
+  if (roundController->isDetecting()) {
+    heapWatermark.sample();
+    while (fsrHandler->checkPunch()) {
+      if (awaitingWakePunch) {
+        recordWakePunch();
       }
+      detectUs.record((uint32_t)(clock.micros64() - fsrHandler->getLastPunch().completedUs));
+      sendPunchData(fsrHandler->getLastPunch().onsetUs);  // Process and send punch data
     }
   }
 
-  DEVICE_NAME.trim();                    // Remove extra spaces
-  BLEDevice::deinit();                   // Reset BLE stack
-  BLEDevice::init(DEVICE_NAME.c_str());  // Reinitialize with device name
+  // Round and break boundaries are decided here, on this clock; the app
+  // only follows the RoundState events
+  RoundEvent event = roundController->update();
+  if (event != RoundEventNone) {
+    reportRoundBoundary(event);
+  }
 
-  bluetoothHandler->begin(DEVICE_NAME.c_str());  // Start BLE with your device name
-  fsrHandler->setup();
-  Serial.print(DEVICE_NAME);
-  Serial.print(" BLE Device is Ready  ");
-  Serial.println("BoxingApp is ready... ");
-  Serial.println("Waiting for client connections...");
+  // Sleep until the next batch of samples or the next boundary
+  uint64_t boundaryUs = roundController->getMicrosToBoundary();
+  TickType_t wait = roundController->isDetecting() ? sampleWait : portMAX_DELAY;
+  if (boundaryUs != UINT64_MAX) {
+    uint64_t tickUs = (uint64_t)portTICK_PERIOD_MS * 1000ULL;
+    uint64_t boundaryTicks = (boundaryUs + tickUs - 1) / tickUs;
+    if (boundaryTicks < wait) {
+      wait = boundaryTicks > 0 ? (TickType_t)boundaryTicks : 1;
+    }
+  }
+  return wait;
 }
 
+// stateLock held. A round ending starts the break or finishes the
+// program; a break ending starts the next round.
+void BoxingApp::reportRoundBoundary(RoundEvent event) {
+  int round = roundController->getCurrentRound();
+  int rounds = roundController->getRounds();
+  MessageBuffer<96> message;
+  switch (event) {
+    case RoundEventBreakStarted:
+      LOG_INFO("Round %d of %d complete, break.", round, rounds);
+      message.appendf("{\"RoundState\":\"Break\",\"Round\":%d,\"Rounds\":%d,\"BreakMs\":%ld}",
+                      round, rounds, roundController->getBreakTime());
+      logRoundHeap();
+      break;
+    case RoundEventRoundStarted:
+      LOG_INFO("Starting round %d of %d...", round, rounds);
+      fsrHandler->resetPunchCount();
+      heapWatermark.mark();
+      message.appendf("{\"RoundState\":\"Started\",\"Time\":\"0...s\",\"Round\":%d,\"Rounds\":%d}",
+                      round, rounds);
+      break;
+    case RoundEventCompleted:
+      LOG_INFO("Round complete.");
+      message.appendf("{\"RoundState\":\"Completed\",\"Round\":%d,\"Rounds\":%d}", round, rounds);
+      logRoundHeap();
+      break;
+    default:
+      return;
+  }
+  bluetoothHandler->queueMessage(message.c_str());
+  updateSampler();
+  xTaskNotifyGive(protocolTask);  // link profile follows the round
+}
 
-void BoxingApp::loop() {
-  handleCommands();
+// stateLock held. Ends the wake window opened by runStandby().
+void BoxingApp::recordWakePunch() {
+  uint32_t latencyUs = (uint32_t)(clock.micros64() - impactWakeUs);
+  wakeToPunchUs.record(latencyUs);
+  awaitingWakePunch = false;
+  LOG_INFO("Standby wake: punch detected after %lu us.", (unsigned long)latencyUs);
+  updateSampler();
+}
 
-  // If the round is active and not paused, check for punches
-  if (roundActive && !isPaused) {
-    if (fsrHandler->checkPunch()) {
-      sendPunchData();  // Process and send punch data
+// The ADC runs only while a round is detecting, the pads are being
+// calibrated, a standby wake waits for its punch or the raw waveform is
+// streamed; otherwise it is stopped and the sampling task sleeps.
+void BoxingApp::updateSampler() {
+  bool wanted = calibrating || roundController->isDetecting() || awaitingWakePunch || streamingWaveform;
+  if (wanted != samplingActive) {
+    if (adcSampling) {
+      if (wanted) {
+        fsrSampler->begin();
+      } else {
+        fsrSampler->end();
+      }
     }
+    fsrHandler->discardPending();
+    samplingActive = wanted;
+  }
+  if (samplingTask != nullptr) {
+    xTaskNotifyGive(samplingTask);
+  }
+}
 
-    // End the round when time elapses
-    if (timeHandler->getElapsedMilliseconds() >= roundTime) {
-      Serial.println("Round complete.");
-      roundActive = false;
-      bluetoothHandler->sendMessage("{\"RoundState\":\"Completed\"}");
-      timeHandler->reset();
+void BoxingApp::updateLink() {
+  bool detecting;
+  {
+    StateGuard guard(stateLock);
+    // A new client has to ask for binary frames again; old apps only read text
+    if (binaryPunches && !bluetoothHandler->isDeviceConnected()) {
+      binaryPunches = false;
     }
+    // Nobody left to stream to
+    if (streamingWaveform && !bluetoothHandler->isDeviceConnected()) {
+      stopWaveformLocked();
+    }
+    detecting = roundController->isDetecting() || streamingWaveform;
   }
+  // Fast connection events only while punches (or raw samples) can arrive
+  bluetoothHandler->setLowLatency(detecting);
 }
 
 void BoxingApp::handleCommands() {
-  String incomingMessage = bluetoothHandler->readMessage();
-  if (incomingMessage.length() > 0) {
+  char incomingMessage[RxCommandQueue::kSlotSize];
+  size_t length;
+  uint64_t receivedMicros;  // T2 of a ClockSync exchange, stamped on arrival
+  while ((length = bluetoothHandler->readCommand(incomingMessage, sizeof(incomingMessage), receivedMicros)) > 0) {
+    LOG_INFO("Received message: %s", incomingMessage);
 
     StaticJsonDocument<256> jsonDoc;
-    DeserializationError error = deserializeJson(jsonDoc, incomingMessage);
+    DeserializationError error = deserializeJson(jsonDoc, incomingMessage, length);
     if (error) {
-      Serial.print("JSON Parsing Failed: ");
-      Serial.println(error.c_str());
-      return;
+      LOG_WARN("JSON Parsing Failed: %s", error.c_str());
+      continue;
     }
 
+    // State changes happen under stateLock; replies go out once it is
+    // released, so a slow notification never holds up the sampling task.
+
     // Handle sensor settings update
     if (jsonDoc.containsKey("SensorSettings")) {
       JsonObject settings = jsonDoc["SensorSettings"];
-      fsrSensitivity = settings["FsrSensitivity"];
-      fsrThreshold = settings["FsrThreshold"];
-      roundTime = settings["RoundTime"];
-      breakTime = settings["BreakTime"];
-      fsrHandler->setSensitivity(fsrSensitivity);
-      fsrHandler->setThreshold(fsrThreshold);
-      // Serial.println("Sensor settings updated.");
-      // Serial.println(fsrHandler->getSensitivity());
-      // Serial.println(fsrHandler->getThreshold());
+      {
+        StateGuard guard(stateLock);
+        fsrSensitivity = settings["FsrSensitivity"];
+        fsrThreshold = settings["FsrThreshold"];
+        roundController->setRoundTime(settings["RoundTime"]);
+        roundController->setBreakTime(settings["BreakTime"]);
+        if (settings.containsKey("Rounds")) {
+          roundController->setRounds(settings["Rounds"]);
+        }
+        if (settings.containsKey("StandbyS")) {
+          standbyIdleUs = (uint64_t)settings["StandbyS"].as<uint32_t>() * 1000000ULL;  // 0 = never
+        }
+        fsrHandler->setSensitivity(fsrSensitivity);
+        fsrHandler->setThreshold(fsrThreshold);
+        if (settings.containsKey("SampleRateHz")) {
+          sampleRateHz = settings["SampleRateHz"];
+          fsrSampler->setSampleRate(sampleRateHz);
+        }
+        if (settings.containsKey("Adaptive")) {
+          fsrHandler->setAdaptive(settings["Adaptive"]);
+        }
+      }
+      if (settings.containsKey("CoalesceMs")) {
+        bluetoothHandler->setCoalesceDelayMs(settings["CoalesceMs"]);
+      }
       bluetoothHandler->sendMessage("{\"RoundState\":\"Settings Updated\"}");
-      bluetoothHandler->clearMessage();
+    }
+
+    // Punch report format: "Binary" (PunchFrame) or "Text"
+    if (jsonDoc.containsKey("PunchFormat")) {
+      MessageBuffer<64> reply;
+      {
+        StateGuard guard(stateLock);
+        binaryPunches = jsonDoc["PunchFormat"] == "Binary";
+        if (binaryPunches) {
+          reply.appendf("{\"PunchFormat\":\"Binary\",\"Version\":%u,\"NextSeq\":%u}",
+                        (unsigned)kPunchFrameVersion, (unsigned)punchHistory.getNextSeq());
+        } else {
+          reply.append("{\"PunchFormat\":\"Text\"}");
+        }
+      }
+      bluetoothHandler->sendMessage(reply.c_str());
+    }
+
+    // NTP-style timestamp exchange. The app keeps its own send (T1) and
+    // receive (T4) times; T2/T3 are this clock's receive and reply times.
+    // RoundUs is the round time at T3, so T3 - RoundUs places round time 0
+    // on this clock and lets the app align both boxers' punch streams.
+    if (jsonDoc.containsKey("ClockSync")) {
+      unsigned long id = jsonDoc["ClockSync"]["Id"] | 0UL;
+      MessageBuffer<160> reply;
+      {
+        StateGuard guard(stateLock);
+        uint64_t roundMicros = timeHandler->getElapsedMicros();
+        bool detecting = roundController->isDetecting();
+        reply.appendf("{\"ClockSync\":{\"Id\":%lu,\"T2\":%llu,\"T3\":%llu,\"RoundUs\":%llu,\"Detecting\":%s}}",
+                      id, (unsigned long long)receivedMicros, (unsigned long long)clock.micros64(),
+                      (unsigned long long)roundMicros, detecting ? "true" : "false");
+      }
+      bluetoothHandler->sendMessage(reply.c_str());
+    }
+
+    // Dump the telemetry histograms on the diagnostics characteristic;
+    // Reset starts a new session
+    if (jsonDoc.containsKey("Diagnostics")) {
+      sendDiagnostics(jsonDoc["Diagnostics"]["Reset"] | false);
+    }
+
+    // Provision this sensor's role; applies from the next boot
+    if (jsonDoc.containsKey("SetRole")) {
+      uint8_t device = punchDeviceFromName(jsonDoc["SetRole"].as<const char*>());
+      MessageBuffer<96> reply;
+      reply.appendf("{\"SetRole\":\"%s\",\"Status\":\"%s\"}", punchDeviceName(device),
+                    storeDeviceRole(device) ? "Stored" : "Failed");
+      bluetoothHandler->sendMessage(reply.c_str());
+    }
+
+    // Replay punches the app missed
+    if (jsonDoc.containsKey("Resend")) {
+      resendPunches(jsonDoc["Resend"]["FromSeq"]);
+    }
+
+    // Punches kept in flash: what is there, and download a boot session
+    // (all of it, or from FromSeq on) at full link speed
+    if (jsonDoc.containsKey("JournalInfo")) {
+      MessageBuffer<128> reply;
+      reply.appendf("{\"JournalInfo\":{\"Ready\":%s,\"Session\":%u,\"Segments\":%lu,\"Dropped\":%lu}}",
+                    journal.isReady() ? "true" : "false", (unsigned)journal.getSession(),
+                    (unsigned long)journal.getSegmentCount(), (unsigned long)journal.getDroppedRecords());
+      bluetoothHandler->sendMessage(reply.c_str());
+    }
+    if (jsonDoc.containsKey("JournalSync")) {
+      JsonObject sync = jsonDoc["JournalSync"];
+      uint16_t session = sync["Session"] | journal.getSession();
+      sendJournal(session, sync.containsKey("FromSeq"), sync["FromSeq"] | 0);
+    }
+
+    // Measure idle level and noise of every pad; keep the pads untouched
+    if (jsonDoc.containsKey("Calibrate")) {
+      unsigned long seconds = jsonDoc["Calibrate"]["Seconds"] | 3;
+      MessageBuffer<64> reply;
+      {
+        StateGuard guard(stateLock);
+        if (roundController->isDetecting() || roundController->isInBreak()) {
+          reply.append("{\"Error\":\"Calibrate during round\"}");
+        } else {
+          LOG_INFO("Calibrating pads for %lus...", seconds);
+          fsrHandler->startCalibration(seconds * 1000UL);
+          calibrating = true;
+          updateSampler();
+          reply.appendf("{\"Calibration\":{\"Status\":\"Started\",\"Seconds\":%lu}}", seconds);
+        }
+      }
+      bluetoothHandler->sendMessage(reply.c_str());
+    }
+
+    // Raw samples of every pad for diagnostics, until Stream is false
+    if (jsonDoc.containsKey("Waveform")) {
+      startWaveform(jsonDoc["Waveform"]["Stream"] | false);
+    }
+
+    // Force curve of one pad from reference weights: [[mV, 0.1 N], ...]
+    if (jsonDoc.containsKey("CalibrationUpload")) {
+      uploadForceCurve(jsonDoc["CalibrationUpload"]);
     }
 
     // Handle round commands
     if (jsonDoc.containsKey("RoundStatusCommand")) {
       int commandValue = jsonDoc["RoundStatusCommand"]["Command"];
-      unsigned long elapsedSeconds = timeHandler->getElapsedSeconds();
-
-      switch (commandValue) {
-        case 1:  // Start round
-          Serial.println("Starting the round at " + String(elapsedSeconds) + "s...");
-          fsrHandler->resetPunchCount();
-          timeHandler->reset();
-          timeHandler->start();
-          roundActive = true;
-          isPaused = false;
-          bluetoothHandler->sendMessage("{\"RoundState\":\"Started\",\"Time\":\"" + String(elapsedSeconds) + "...s\"}");
-          bluetoothHandler->clearMessage();
-          break;
-        case 2:  // Pause round
-          Serial.println("Pausing the round at " + String(elapsedSeconds) + "s...");
-          timeHandler->pause();
-          isPaused = true;
-          bluetoothHandler->sendMessage("{\"RoundState\":\"Paused\",\"Time\":\"" + String(elapsedSeconds) + "...s\"}");
-          bluetoothHandler->clearMessage();
-          break;
-        case 3:  // Resume round
-          Serial.println("Resuming the round at " + String(elapsedSeconds) + "s...");
-          timeHandler->resume();
-          isPaused = false;
-          bluetoothHandler->sendMessage("{\"RoundState\":\"Resumed\",\"Time\":\"" + String(elapsedSeconds) + "...s\"}");
-          bluetoothHandler->clearMessage();
-          break;
-        case 4:  // Reset round
-          Serial.println("Resetting the round at " + String(elapsedSeconds) + "s...");
-          fsrHandler->resetPunchCount();
-          timeHandler->reset();
-          timeHandler->start();
-          roundActive = true;
-          isPaused = false;
-          bluetoothHandler->sendMessage("{\"RoundState\":\"Reset\",\"Time\":\"0s\"}");
-          bluetoothHandler->clearMessage();
-          break;
-        case 5:  // End round
-          Serial.println("Ending the round at " + String(elapsedSeconds) + "s...");
-          roundActive = false;
-          bluetoothHandler->sendMessage("{\"RoundState\":\"Ended\",\"FinalTime\":\"" + String(elapsedSeconds) + "s\"}");
-          timeHandler->reset();
-          fsrHandler->resetPunchCount();
-          bluetoothHandler->clearMessage();
-          break;
-        default:
-          Serial.println("Unknown Command Received.");
-          bluetoothHandler->sendMessage("{\"Error\":\"Unknown Command\"}");
-          bluetoothHandler->clearMessage();
-          break;
+      MessageBuffer<96> reply;
+      {
+        StateGuard guard(stateLock);
+        unsigned long elapsedSeconds = timeHandler->getElapsedSeconds();
+        switch (roundController->handleCommand(commandValue)) {
+          case RoundEventStarted:
+            LOG_INFO("Starting the round at %lus...", elapsedSeconds);
+            fsrHandler->resetPunchCount();
+            heapWatermark.mark();
+            reply.appendf("{\"RoundState\":\"Started\",\"Time\":\"%lu...s\",\"Round\":1,\"Rounds\":%d}",
+                          elapsedSeconds, roundController->getRounds());
+            break;
+          case RoundEventPaused:
+            LOG_INFO("Pausing the round at %lus...", elapsedSeconds);
+            reply.appendf("{\"RoundState\":\"Paused\",\"Time\":\"%lu...s\"}", elapsedSeconds);
+            break;
+          case RoundEventResumed:
+            LOG_INFO("Resuming the round at %lus...", elapsedSeconds);
+            reply.appendf("{\"RoundState\":\"Resumed\",\"Time\":\"%lu...s\"}", elapsedSeconds);
+            break;
+          case RoundEventReset:
+            LOG_INFO("Resetting the round at %lus...", elapsedSeconds);
+            fsrHandler->resetPunchCount();
+            reply.append("{\"RoundState\":\"Reset\",\"Time\":\"0s\"}");
+            break;
+          case RoundEventEnded:
+            LOG_INFO("Ending the round at %lus...", elapsedSeconds);
+            reply.appendf("{\"RoundState\":\"Ended\",\"FinalTime\":\"%lus\"}", elapsedSeconds);
+            fsrHandler->resetPunchCount();
+            logRoundHeap();
+            break;
+          default:
+            LOG_WARN("Unknown Command Received.");
+            reply.append("{\"Error\":\"Unknown Command\"}");
+            break;
+        }
+        updateSampler();
       }
+      bluetoothHandler->sendMessage(reply.c_str());
     }
   }
 }
 
-void BoxingApp::sendPunchData() {
-  unsigned long elapsedMilliseconds = timeHandler->getElapsedMilliseconds();
+// Streams the journaled frames of one session, as many records per
+// notification as the MTU takes. Runs on the protocol task; the sampling
+// task and the journal writer carry on meanwhile.
+void BoxingApp::sendJournal(uint16_t session, bool fromSeqSet, uint16_t fromSeq) {
+  MessageBuffer<96> reply;
+  size_t perChunk = (bluetoothHandler->getPayloadLimit() - 1) / kJournalRecordSize;
+  if (perChunk == 0) {
+    // A record plus the marker needs an MTU of at least 24
+    bluetoothHandler->sendMessage("{\"JournalSync\":{\"Error\":\"MTU too small\"}}");
+    return;
+  }
+  if (perChunk > 12) {
+    perChunk = 12;
+  }
+  reply.appendf("{\"JournalSync\":{\"Session\":%u,\"Status\":\"Started\"}}", (unsigned)session);
+  bluetoothHandler->sendMessage(reply.c_str());
+  uint8_t chunk[1 + 12 * kJournalRecordSize];
+  uint8_t records[12 * kJournalRecordSize];
+  size_t chunkRecords = 0;
+  unsigned long sent = 0;
+  chunk[0] = kJournalChunkMarker;
+
+  JournalStore::Cursor cursor = journal.first();
+  size_t count;
+  while ((count = journal.read(cursor, records, perChunk)) > 0 && bluetoothHandler->isDeviceConnected()) {
+    for (size_t i = 0; i < count; i++) {
+      const uint8_t* data = records + i * kJournalRecordSize;
+      JournalRecord record;
+      PunchFrame frame;
+      if (!decodeJournalRecord(data, kJournalRecordSize, record) || record.session != session ||
+          !decodePunchFrame(record.frame, kPunchFrameSize, frame)) {
+        continue;
+      }
+      if (fromSeqSet && (uint16_t)(frame.seq - fromSeq) >= 0x8000) {
+        continue;  // before FromSeq
+      }
+      memcpy(chunk + 1 + chunkRecords * kJournalRecordSize, data, kJournalRecordSize);
+      if (++chunkRecords == perChunk) {
+        bluetoothHandler->sendChunk(chunk, 1 + chunkRecords * kJournalRecordSize);
+        sent += chunkRecords;
+        chunkRecords = 0;
+        vTaskDelay(1);  // lets the controller drain its buffers
+      }
+    }
+  }
+  if (chunkRecords > 0) {
+    bluetoothHandler->sendChunk(chunk, 1 + chunkRecords * kJournalRecordSize);
+    sent += chunkRecords;
+  }
+
+  reply.clear();
+  reply.appendf("{\"JournalSync\":{\"Session\":%u,\"Records\":%lu,\"Status\":\"Done\"}}",
+                (unsigned)session, sent);
+  bluetoothHandler->sendMessage(reply.c_str());
+  LOG_INFO("Journal session %u: %lu records sent", (unsigned)session, sent);
+}
+
+void BoxingApp::sendCalibrationResult() {
+  StaticJsonDocument<256> jsonDoc;
+  JsonObject calibration = jsonDoc.createNestedObject("Calibration");
+  calibration["Status"] = "Done";
+  JsonArray baseline = calibration.createNestedArray("Baseline");
+  JsonArray noise = calibration.createNestedArray("Noise");
+  JsonArray trigger = calibration.createNestedArray("Trigger");
+  for (size_t ch = 0; ch < fsrHandler->getChannelCount(); ch++) {
+    baseline.add(fsrHandler->getBaselineMv(ch));
+    noise.add(fsrHandler->getNoiseMv(ch));
+    trigger.add(fsrHandler->getTriggerMv(ch));
+  }
+  char reply[200];
+  serializeJson(jsonDoc, reply, sizeof(reply));
+  LOG_INFO("%s", reply);
+  bluetoothHandler->queueMessage(reply);
+}
+
+void BoxingApp::resendPunches(uint16_t fromSeq) {
+  uint16_t firstSeq;
+  uint16_t nextSeq;
+  size_t lost;
+  {
+    StateGuard guard(stateLock);
+    firstSeq = punchHistory.resendStart(fromSeq, lost);
+    nextSeq = punchHistory.getNextSeq();
+  }
+  MessageBuffer<80> reply;
+  reply.appendf("{\"Resend\":{\"FromSeq\":%u,\"NextSeq\":%u,\"Lost\":%u}}",
+                (unsigned)firstSeq, (unsigned)nextSeq, (unsigned)lost);
+  bluetoothHandler->sendMessage(reply.c_str());
+  // One frame at a time: the sampling task may store new punches meanwhile
+  for (uint16_t seq = firstSeq; seq != nextSeq; seq++) {
+    uint8_t frame[kPunchFrameSize];
+    bool found;
+    {
+      StateGuard guard(stateLock);
+      const uint8_t* stored = punchHistory.find(seq);
+      found = stored != nullptr;
+      if (found) {
+        memcpy(frame, stored, sizeof(frame));
+      }
+    }
+    if (found) {
+      bluetoothHandler->sendBytes(frame, sizeof(frame));
+    }
+  }
+  bluetoothHandler->flushPending();
+}
+
+// Protocol task. The curve is checked and written to NVS first; the
+// detector only takes it once it is stored.
+void BoxingApp::uploadForceCurve(JsonObject upload) {
+  int channel = upload["Channel"] | -1;
+  JsonArray list = upload["Points"];
+  ForcePoint points[ForceCurve::kMaxPoints];
+  size_t count = 0;
+  bool valid = channel >= 0 && (size_t)channel < fsrHandler->getChannelCount() &&
+               list.size() <= ForceCurve::kMaxPoints;
+  for (JsonArray point : list) {
+    long mv = point[0] | -1L;
+    long force = point[1] | -1L;
+    if (!valid || mv < 0 || mv > 0xFFFF || force < 0 || force > 0xFFFF) {
+      valid = false;
+      break;
+    }
+    points[count].mv = (uint16_t)mv;
+    points[count].forceDn = (uint16_t)force;
+    count++;
+  }
+  ForceCurve curve;
+  valid = valid && curve.set(points, count);
+
+  const char* status = "Rejected";
+  if (valid) {
+    if (storeForceCurve(channel, curve)) {
+      StateGuard guard(stateLock);
+      fsrHandler->setForceCurve(channel, points, count);
+      status = "Stored";
+    } else {
+      status = "Failed";
+    }
+  }
+  LOG_INFO("Force curve of pad %d: %u points, %s", channel, (unsigned)count, status);
+
+  MessageBuffer<192> reply;
+  reply.appendf("{\"CalibrationUpload\":{\"Channel\":%d,\"Points\":[", channel);
+  for (size_t i = 0; valid && i < count; i++) {
+    reply.appendf(i == 0 ? "[%u,%u]" : ",[%u,%u]", (unsigned)points[i].mv, (unsigned)points[i].forceDn);
+  }
+  reply.appendf("],\"Status\":\"%s\"}}", status);
+  bluetoothHandler->sendMessage(reply.c_str());
+}
+
+// Protocol task. Refused during rounds, breaks and calibration, which
+// need the samples for the detector.
+void BoxingApp::startWaveform(bool stream) {
+  MessageBuffer<128> reply;
+  size_t payload = bluetoothHandler->getPayloadLimit();
+  size_t channels = fsrHandler->getChannelCount();
+  {
+    StateGuard guard(stateLock);
+    if (!stream) {
+      if (streamingWaveform) {
+        stopWaveformLocked();
+      }
+      return;  // the stop report is queued behind the last packet
+    }
+    if (streamingWaveform) {
+      reply.append("{\"Waveform\":{\"Error\":\"Already streaming\"}}");
+    } else if (calibrating || roundController->isActive() || roundController->isInBreak()) {
+      reply.append("{\"Waveform\":{\"Error\":\"Busy\"}}");
+    } else if (payload < kWaveformHeaderSize + channels * 3) {
+      reply.append("{\"Waveform\":{\"Error\":\"MTU too small\"}}");
+    } else {
+      uint32_t rateHz = adcSampling ? sampleRateHz : configTICK_RATE_HZ / kPolledWaitTicks;
+      waveform.start((uint8_t)channels, payload);
+      waveformAdcDropped = adcSampling ? fsrSampler->getDroppedFrames() : 0;
+      streamingWaveform = true;
+      updateSampler();
+      LOG_INFO("Streaming raw waveform: %u channels at %lu Hz", (unsigned)channels, (unsigned long)rateHz);
+      reply.appendf("{\"Waveform\":{\"Status\":\"Started\",\"Channels\":%u,\"RateHz\":%lu}}",
+                    (unsigned)channels, (unsigned long)rateHz);
+    }
+  }
+  bluetoothHandler->sendMessage(reply.c_str());
+  updateLink();
+}
+
+// Sampling task, stateLock held: every frame the source has goes into
+// the stream. The sampler drops the newest frames when its ring is full,
+// so what it lost lies between the frames drained here and the next ones.
+TickType_t BoxingApp::streamWaveform() {
+  uint16_t frames[32][kMaxAnalogChannels];
+  uint64_t timesUs[32];
+  size_t count;
+  bool queued = false;
+  do {  // the polled source hands out one frame per call
+    count = analogSource->readFrames(frames, timesUs, 32);
+    for (size_t i = 0; i < count; i++) {
+      queued = waveform.addFrame(frames[i]) || queued;
+    }
+  } while (count == 32);
+  if (adcSampling) {
+    uint32_t adcDropped = fsrSampler->getDroppedFrames();
+    queued = waveform.addDropped(adcDropped - waveformAdcDropped) || queued;
+    waveformAdcDropped = adcDropped;
+  }
+  if (queued) {
+    xTaskNotifyGive(protocolTask);
+  }
+  return adcSampling ? kAdcWaitTicks : kPolledWaitTicks;
+}
+
+// stateLock held. The protocol task sends the remaining packets, then
+// the report.
+void BoxingApp::stopWaveformLocked() {
+  waveform.flush();
+  streamingWaveform = false;
+  waveformStopPending = true;
+  updateSampler();
+  LOG_INFO("Waveform stream stopped: %lu frames, %lu dropped", (unsigned long)waveform.getFrames(),
+           (unsigned long)waveform.getDropped());
+  xTaskNotifyGive(protocolTask);
+}
+
+// Protocol task: one notification per packet; the stack paces this loop.
+void BoxingApp::sendWaveform() {
+  uint8_t packet[WaveformStream::PacketQueue::kSlotSize];
+  size_t length;
+  while ((length = waveform.popPacket(packet, sizeof(packet))) > 0) {
+    bluetoothHandler->sendChunk(packet, length);
+  }
+
+  {
+    StateGuard guard(stateLock);
+    if (!waveformStopPending) {
+      return;
+    }
+    waveformStopPending = false;
+  }
+  // Whatever the flush queued after the loop above is still in the queue
+  while ((length = waveform.popPacket(packet, sizeof(packet))) > 0) {
+    bluetoothHandler->sendChunk(packet, length);
+  }
+  MessageBuffer<128> report;
+  report.appendf("{\"Waveform\":{\"Status\":\"Stopped\",\"Frames\":%lu,\"Dropped\":%lu}}",
+                 (unsigned long)waveform.getFrames(), (unsigned long)waveform.getDropped());
+  bluetoothHandler->sendMessage(report.c_str());
+}
+
+void BoxingApp::logRoundHeap() {
+  LOG_INFO("Heap: free %u, round delta %ld, round dip %u, min since boot %u",
+           (unsigned)heapWatermark.getFree(), heapWatermark.getDeltaSinceMark(),
+           (unsigned)heapWatermark.getDipSinceMark(), (unsigned)heapWatermark.getMinimumFree());
+}
+
+// Protocol task: samples the heap and refreshes the summary on the
+// diagnostics characteristic every kDiagnosticsPeriodUs.
+void BoxingApp::updateDiagnostics() {
+  heapFree.record((uint32_t)heapWatermark.getFree());
+  uint64_t now = clock.micros64();
+  if (now - lastDiagnosticsUs < kDiagnosticsPeriodUs) {
+    return;
+  }
+  lastDiagnosticsUs = now;
+  MessageBuffer<244> summary;
+  formatDiagnosticsSummary(summary);
+  bluetoothHandler->publishDiagnostics(summary.c_str());
+}
+
+void BoxingApp::formatDiagnosticsSummary(MessageBuffer<244>& out) {
+  LatencyHistogram loop;
+  LatencyHistogram detect;
+  LatencyHistogram notify;
+  {
+    StateGuard guard(stateLock);
+    loop = loopUs;
+    detect = detectUs;
+  }
+  bluetoothHandler->copyNotifyLatency(notify, false);
+  out.appendf("{\"Diagnostics\":{\"UpS\":%lu,\"LoopP99Us\":%lu,\"DetectP99Us\":%lu,\"NotifyP99Us\":%lu,"
+              "\"NotifyFail\":%lu,\"NotifySkip\":%lu,\"CmdDepthMax\":%lu,\"CmdDrop\":%lu,\"OutDrop\":%lu,\"AdcDrop\":%lu,"
+              "\"HeapFree\":%u,\"HeapMin\":%u}}",
+              (unsigned long)(clock.micros64() / 1000000ULL), (unsigned long)loop.percentile(990),
+              (unsigned long)detect.percentile(990), (unsigned long)notify.percentile(990),
+              (unsigned long)bluetoothHandler->getNotifyFailures(),
+              (unsigned long)bluetoothHandler->getNotifySkipped(), (unsigned long)commandDepth.getMax(),
+              (unsigned long)(bluetoothHandler->getDroppedCommands() + bluetoothHandler->getOversizedCommands()),
+              (unsigned long)bluetoothHandler->getDroppedOutbound(),
+              (unsigned long)(adcSampling ? fsrSampler->getDroppedFrames() : 0),
+              (unsigned)heapWatermark.getFree(), (unsigned)heapWatermark.getMinimumFree());
+}
+
+// Protocol task. Returns the ticks until the sensor has been idle for
+// standbyIdleUs (no client, no round or break, no calibration) and goes
+// to standby; portMAX_DELAY while it is busy.
+TickType_t BoxingApp::updateStandby() {
+  uint64_t now = clock.micros64();
+  bool idle;
+  uint64_t idleUs;
+  {
+    StateGuard guard(stateLock);
+    idle = standbyIdleUs > 0 && !calibrating && !awaitingWakePunch && !streamingWaveform &&
+           !roundController->isActive() && !roundController->isInBreak();
+    idleUs = standbyIdleUs;
+  }
+  if (!idle || bluetoothHandler->isDeviceConnected()) {
+    idleSinceUs = now;
+    return portMAX_DELAY;
+  }
+  if (now - idleSinceUs < idleUs) {
+    uint64_t tickUs = (uint64_t)portTICK_PERIOD_MS * 1000ULL;
+    return (TickType_t)((idleSinceUs + idleUs - now + tickUs - 1) / tickUs);
+  }
+  runStandby();
+  idleSinceUs = clock.micros64();
+  return (TickType_t)((idleUs + 999ULL) / 1000ULL / portTICK_PERIOD_MS);
+}
+
+// Protocol task. Light sleep until a pad is hit or a client connects in
+// one of the short advertising windows between sleep slices.
+void BoxingApp::runStandby() {
+  LOG_INFO("Idle for %lu s, standby.", (unsigned long)(standbyIdleUs / 1000000ULL));
+  bluetoothHandler->setAdvertising(false);
+  SleepWake wake;
+  for (;;) {
+    wake = sleepHandler->sleep(kStandbySliceUs);
+    if (wake == SleepWakeImpact) {
+      break;
+    }
+    // Connecting notifies this task, which ends the window early
+    bluetoothHandler->setAdvertising(true);
+    ulTaskNotifyTake(pdTRUE, kStandbyAdvertiseTicks);
+    if (bluetoothHandler->isDeviceConnected()) {
+      break;
+    }
+    bluetoothHandler->setAdvertising(false);
+  }
+
+  if (wake != SleepWakeImpact) {
+    LOG_INFO("Standby: client connected.");
+    return;
+  }
+  bluetoothHandler->setAdvertising(true);
+  {
+    StateGuard guard(stateLock);
+    impactWakeUs = sleepHandler->getWakeUs();
+    awaitingWakePunch = true;
+    updateSampler();
+  }
+  LOG_INFO("Standby: woken by a hit.");
+}
+
+// Width 0 marks power-of-two buckets (see Histogram).
+template <size_t Buckets>
+void BoxingApp::publishHistogram(const char* name, uint32_t width, const Histogram<Buckets>& histogram) {
+  MessageBuffer<244> message;
+  message.appendf("{\"Diag\":\"%s\",\"Width\":%lu,", name, (unsigned long)width);
+  histogram.appendJson(message);
+  message.append("}");
+  if (message.isTruncated()) {
+    LOG_WARN("Diagnostics: %s histogram cut to %u bytes", name, (unsigned)message.size());
+  }
+  bluetoothHandler->publishDiagnostics(message.c_str());
+}
+
+// One notification per histogram, then the summary. With reset the
+// histograms start over, so every dump covers one session.
+void BoxingApp::sendDiagnostics(bool reset) {
+  MessageBuffer<244> summary;
+  formatDiagnosticsSummary(summary);  // before the reset below
+
+  LatencyHistogram loop;
+  LatencyHistogram detect;
+  LatencyHistogram notify;
+  LatencyHistogram wake;
+  {
+    StateGuard guard(stateLock);
+    loop = loopUs;
+    detect = detectUs;
+    wake = wakeToPunchUs;
+    if (reset) {
+      loopUs.reset();
+      detectUs.reset();
+      wakeToPunchUs.reset();
+    }
+  }
+  bluetoothHandler->copyNotifyLatency(notify, reset);
+
+  publishHistogram("LoopUs", 0, loop);
+  publishHistogram("DetectUs", 0, detect);
+  publishHistogram("NotifyUs", 0, notify);
+  publishHistogram("CommandDepth", 1, commandDepth);
+  publishHistogram("HeapFree", 16384, heapFree);
+  publishHistogram("WakeToPunchUs", 0, wake);
+
+  bluetoothHandler->publishDiagnostics(summary.c_str());
+  lastDiagnosticsUs = clock.micros64();
+  if (reset) {
+    commandDepth.reset();
+    heapFree.reset();
+  }
+}
+
+void BoxingApp::sendPunchData(uint64_t punchTimeUs) {
+  // Stamp the punch with the round time at which it was sampled, not sent.
+  // Sample times and the round timer share the esp_timer timebase.
+  uint64_t elapsedMicros = timeHandler->getElapsedMicros();
+  uint64_t sinceSample = clock.micros64() - punchTimeUs;
+  if (sinceSample < elapsedMicros) {
+    elapsedMicros -= sinceSample;
+  }
 
   if (fsrHandler->getFsrValue() > fsrHandler->getThreshold()) {
     fsrHandler->increasePunch();
-    String punchDetails = fsrHandler->getPunchDetails(elapsedMilliseconds);
-    //Serial.println(punchDetails); // print the message in terminal <--------------------------------------------
-    bluetoothHandler->sendMessage(punchDetails);
+    // Every punch is numbered and kept for Resend, whatever format goes out
+    uint8_t frame[kPunchFrameSize];
+    size_t length = fsrHandler->getPunchFrame((uint32_t)elapsedMicros, punchHistory.getNextSeq(),
+                                              frame, sizeof(frame));
+    punchHistory.store(frame);
+    journal.append((uint8_t)roundController->getCurrentRound(), frame);
+    if (binaryPunches) {
+      bluetoothHandler->queueBytes(frame, length);
+      return;
+    }
+    MessageBuffer<244> punchDetails;  // one notification at MTU 247
+    punchDetails.setLength(fsrHandler->getPunchDetails(elapsedMicros, punchDetails.data(),
+                                                       punchDetails.capacity()));
+    bluetoothHandler->queueMessage(punchDetails.c_str());
   }
-}
\ No newline at end of file
+}
@@ -2,39 +2,115 @@
 #define BOXING_APP_H
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ArduinoHal.h"
 #include "BluetoothHandler.h"
-#include "FSRPunchDetector.h"
+#include "FixedPunchDetector.h"
+#include "FsrSampler.h"
 #include "TimeHandler.h"
-// #include "SleepHandler.h"
+#include "RoundController.h"
+#include "PunchHistory.h"
+#include "JournalStore.h"
+#include "MessageBuffer.h"
+#include "Telemetry.h"
+#include "SleepHandler.h"
+#include "WaveformStream.h"
+
+// Analog pins of the bag's pads; build with e.g. -DFSR_PAD_PINS=4 for a
+// one-pad bag. The detector is specialised for exactly these pins.
+#ifndef FSR_PAD_PINS
+#define FSR_PAD_PINS 4, 5, 6
+#endif
+typedef FixedPunchDetector<FSR_PAD_PINS> PadPunchDetector;
 
 class BoxingApp {
 private:
   BluetoothHandler* bluetoothHandler;
-  FSRPunchDetector* fsrHandler;
+  PadPunchDetector* fsrHandler;
+  FsrSampler* fsrSampler;
+  PolledAnalogSource* polledSource;
+  AnalogSource* analogSource;  // whichever of the two feeds the detector
+  SleepHandler* sleepHandler;
   TimeHandler* timeHandler;
+  RoundController* roundController;
+  ArduinoClock clock;
+  SerialLogger logger;
+  HeapWatermark heapWatermark;  // free heap across a round; should not move
+
+  // Health telemetry, dumped with {"Diagnostics":{}}. The sampling task
+  // writes loopUs and detectUs under stateLock; the protocol task owns
+  // the rest.
+  LatencyHistogram loopUs;        // one sampling task pass
+  LatencyHistogram detectUs;      // completing sample -> punch detected
+  Histogram<9> commandDepth;      // commands waiting when the protocol task wakes
+  Histogram<16> heapFree;         // 16 KB buckets
+  uint64_t lastDiagnosticsUs;
+
+  // Standby: light sleep once no client is connected and no round runs
+  // for standbyIdleUs. A hit on a pad wakes the sensor; the detector then
+  // runs until it sees that punch and wakeToPunchUs records how long that
+  // took (sampling task, under stateLock).
+  uint64_t standbyIdleUs;   // 0 = never
+  uint64_t idleSinceUs;
+  bool awaitingWakePunch;
+  uint64_t impactWakeUs;
+  LatencyHistogram wakeToPunchUs;
+
+  // Raw waveform stream for diagnostics: outside rounds and calibration
+  // the sampling task hands every frame to the stream instead of the
+  // detector, and the protocol task sends the packets.
+  bool streamingWaveform;   // stateLock
+  bool waveformStopPending; // stateLock; report follows the last packet
+  uint32_t waveformAdcDropped;  // sampler drop count already in the stream
+  WaveformStream waveform;
+
+  // Tasks (see setup()). stateLock guards the round, the detector and the
+  // punch history, which both the sampling and the protocol task touch.
+  TaskHandle_t samplingTask;
+  TaskHandle_t protocolTask;
+  SemaphoreHandle_t stateLock;
+  bool adcSampling;     // FsrSampler in use, otherwise polled reads
+  bool samplingActive;  // detector is being fed
 
   // App configuration
-  bool startReading;
-  long roundTime;
-  long breakTime;
   int fsrSensitivity;
   int fsrThreshold;
-  bool isPaused;
-  unsigned long elapsedTime;
-  int command;
-  bool roundActive;
-
-  // added for debugging messages
-  String lastSentPunch;     // Stores the last punch details to detect duplicates
-  int duplicatePunchCount;  // Counts how many times the same punch was detected
+  uint32_t sampleRateHz;
+  bool calibrating;
+  bool binaryPunches;  // app asked for PunchFrame instead of text
+  PunchHistory punchHistory;  // sent frames, replayed on Resend
+  JournalStore journal;       // every frame in flash, for JournalSync
 
+  static void samplingTaskEntry(void* arg);
+  static void protocolTaskEntry(void* arg);
+  TickType_t processSamples();  // stateLock held; returns how long the task may sleep
+  void reportRoundBoundary(RoundEvent event);
+  void updateSampler();   // stateLock held
+  void updateLink();
   void handleCommands();
+  void sendCalibrationResult();
+  void resendPunches(uint16_t fromSeq);
+  void sendJournal(uint16_t session, bool fromSeqSet, uint16_t fromSeq);
+  void logRoundHeap();
+  void updateDiagnostics();
+  void uploadForceCurve(JsonObject upload);
+  void startWaveform(bool stream);
+  TickType_t streamWaveform();  // sampling task, stateLock held
+  void stopWaveformLocked();    // stateLock held
+  void sendWaveform();          // protocol task
+  TickType_t updateStandby();  // protocol task; ticks until standby is due
+  void runStandby();
+  void recordWakePunch();  // stateLock held
+  void sendDiagnostics(bool reset);
+  template <size_t Buckets>
+  void publishHistogram(const char* name, uint32_t width, const Histogram<Buckets>& histogram);
+  void formatDiagnosticsSummary(MessageBuffer<244>& out);
 
 public:
   BoxingApp();
   void setup();
   void loop();
-  void sendPunchData();  // Sends punch data with duplicate prevention
+  void sendPunchData(uint64_t punchTimeUs);  // Sends the last punch, stamped at its sample time
 };
 
 #endif  // BOXING_APP_H
\ No newline at end of file
@@ -0,0 +1,89 @@
+// CommandQueue.h
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Single-producer / single-consumer queue of commands written by the app.
+// The BLE task pushes, the main loop pops; every command is delivered once
+// and in order. Slots are preallocated, so neither side allocates or
+// blocks: a command that arrives while all slots are full is dropped and
+// counted, one longer than a slot is rejected and counted. Each command
+// can carry the time it arrived, so the consumer's wakeup delay does not
+// end up in timestamps taken from it.
+template <size_t Slots, size_t SlotSize>
+class CommandQueue {
+  static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+  static const size_t kSlotSize = SlotSize;
+
+  CommandQueue()
+    : lengths(), stampsUs(), head(0), tail(0), droppedCommands(0), oversizedCommands(0) {}
+
+  // Producer side. Returns false if the command was dropped.
+  bool push(const char* data, size_t length, uint64_t stampUs = 0) {
+    if (length >= SlotSize) {
+      oversizedCommands.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= Slots) {
+      droppedCommands.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    size_t slot = h & (Slots - 1);
+    memcpy(slots[slot], data, length);
+    slots[slot][length] = '\0';
+    lengths[slot] = length;
+    stampsUs[slot] = stampUs;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies the oldest command, NUL-terminated, into out and
+  // returns its length; 0 when the queue is empty. stampUs, if given,
+  // receives the time passed to push().
+  size_t pop(char* out, size_t outSize, uint64_t* stampUs = nullptr) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) {
+      return 0;
+    }
+    size_t slot = t & (Slots - 1);
+    size_t length = lengths[slot] < outSize ? lengths[slot] : outSize - 1;
+    memcpy(out, slots[slot], length);
+    out[length] = '\0';
+    if (stampUs != nullptr) {
+      *stampUs = stampsUs[slot];
+    }
+    tail.store(t + 1, std::memory_order_release);
+    return length;
+  }
+
+  size_t pending() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+  }
+
+  uint32_t getDroppedCommands() const {
+    return droppedCommands.load(std::memory_order_relaxed);
+  }
+
+  uint32_t getOversizedCommands() const {
+    return oversizedCommands.load(std::memory_order_relaxed);
+  }
+
+private:
+  char slots[Slots][SlotSize];
+  size_t lengths[Slots];
+  uint64_t stampsUs[Slots];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> droppedCommands;
+  std::atomic<uint32_t> oversizedCommands;
+};
+
+#endif  // COMMAND_QUEUE_H
@@ -0,0 +1,42 @@
+// DeviceRole.cpp
+#include "DeviceRole.h"
+#include <Preferences.h>
+#include <esp_mac.h>
+#include "MacDevicesConfig.h"
+#include "AsyncLog.h"
+
+static const char* const kRoleNamespace = "boxing";
+static const char* const kRoleKey = "role";
+
+uint8_t loadDeviceRole() {
+  Preferences prefs;
+  if (prefs.begin(kRoleNamespace, true)) {
+    uint8_t stored = prefs.getUChar(kRoleKey, PunchDeviceUnknown);
+    prefs.end();
+    if (stored != PunchDeviceUnknown) {
+      return stored;
+    }
+  }
+
+  // Same address BLE advertises with, without starting the stack
+  uint8_t mac[6];
+  esp_read_mac(mac, ESP_MAC_BT);
+  uint8_t device = deviceForMac(packMac(mac));
+  LOG_INFO("BLE Address: %02x:%02x:%02x:%02x:%02x:%02x -> %s",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], punchDeviceName(device));
+  if (device != PunchDeviceUnknown) {
+    storeDeviceRole(device);
+  }
+  return device;
+}
+
+bool storeDeviceRole(uint8_t device) {
+  Preferences prefs;
+  if (!prefs.begin(kRoleNamespace, false)) {
+    LOG_WARN("Role: NVS not available");
+    return false;
+  }
+  bool stored = prefs.putUChar(kRoleKey, device) == sizeof(uint8_t);
+  prefs.end();
+  return stored;
+}
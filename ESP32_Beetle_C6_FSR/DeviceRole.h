@@ -0,0 +1,17 @@
+// DeviceRole.h
+#ifndef DEVICE_ROLE_H
+#define DEVICE_ROLE_H
+
+#include <stdint.h>
+
+// Role this sensor reports as (PunchDevice: BlueBoxer or RedBoxer). It is
+// provisioned once into NVS, so a boot reads one byte instead of bringing
+// BLE up just to learn the MAC. Without a stored role the Bluetooth MAC is
+// read from eFuse and looked up in MacDevicesConfig.h, and a match is
+// stored for the next boot.
+uint8_t loadDeviceRole();
+// Stores a role for the next boot; PunchDeviceUnknown goes back to the
+// MAC table.
+bool storeDeviceRole(uint8_t device);
+
+#endif  // DEVICE_ROLE_H
@@ -1,89 +1,294 @@
 // FSRPunchDetector.cpp
 #include "FSRPunchDetector.h"
-#include <Arduino.h>
-
-// Declare that DEVICE_NAME is defined in another file (boxingApp.cpp)
-extern String DEVICE_NAME;
+#include <string.h>
 
 FSRPunchDetector::FSRPunchDetector(const std::initializer_list<int>& pins,
                                    int sensitivity,
                                    int threshold)
   : fsrPins(pins.begin(), pins.end()),
+    channelCount(0),
     fsrSensitivity(sensitivity),
     fsrThreshold(threshold),
-    isPressed(false),
+    adaptive(true),
+    calibrating(false),
+    calibrationStarted(false),
+    calibrationDurationUs(0),
+    calibrationEndUs(0),
+    completedHead(0),
+    completedCount(0),
     punchCount(0),
-    punchPower(0),
-    sensorVoltage(0.0f),
     fsrValue(0),
-    lastPunchTime(0UL) {}
+    lastPunchTime(0UL),
+    deviceName("UnknownDevice"),
+    source(nullptr),
+    logger(nullptr),
+    blockLength(0),
+    blockPosition(0) {
+  if (fsrPins.size() > kMaxChannels) {
+    fsrPins.resize(kMaxChannels);
+  }
+  channelCount = fsrPins.size();
+  for (size_t ch = 0; ch < kMaxChannels; ch++) {
+    channels[ch].hasTriggered = false;
+    channels[ch].lastTriggerUs = 0;
+  }
+  resetState();
+  lastPunch = {};
+}
 
-void FSRPunchDetector::setup() {
-  for (auto pin : fsrPins) {
-    pinMode(pin, INPUT);
+void FSRPunchDetector::setup(AnalogSource* analogSource, Logger* log) {
+  source = analogSource;
+  // Pads the source does not deliver read 0 mV and never fire
+  memset(block, 0, sizeof(block));
+  logger = log;
+  channelCount = fsrPins.size();
+  if (source != nullptr && source->channelCount() < channelCount) {
+    channelCount = source->channelCount();
+  }
+  discardPending();
+  if (logger != nullptr) {
+    logger->log("FSR Punch Detector Initialized.");
   }
-  Serial.println("FSR Punch Detector Initialized.");
 }
 
 bool FSRPunchDetector::checkPunch() {
-  const unsigned long debounceDelay = 200;  // ms between punches
-  unsigned long now = millis();
-
-  // Read all sensors and track the maximum reading
-  int maxReading = 0;
-  for (auto pin : fsrPins) {
-    int mv = analogReadMilliVolts(pin);
-    if (mv > maxReading) {
-      maxReading = mv;
+  const uint16_t* millivolts;
+  uint64_t timeUs;
+  while (!takeCompleted()) {
+    if (!nextFrame(millivolts, timeUs)) {
+      return false;
+    }
+    processFrame(millivolts, timeUs);
+  }
+  return true;
+}
+
+void FSRPunchDetector::discardPending() {
+  blockLength = 0;
+  blockPosition = 0;
+  resetState();
+}
+
+void FSRPunchDetector::resetState() {
+  for (size_t ch = 0; ch < kMaxChannels; ch++) {
+    channels[ch].isPressed = false;
+    channels[ch].punchSlot = -1;
+    channels[ch].pulse.cancel();
+    openPunches[ch].active = false;
+  }
+  completedHead = 0;
+  completedCount = 0;
+}
+
+bool FSRPunchDetector::processFrame(const uint16_t* millivolts, uint64_t timeUs) {
+  if (calibrating) {
+    calibrateFrame(millivolts, timeUs);
+    return completedCount > 0;
+  }
+
+  // Before a pad can re-arm into a punch whose window already ran out
+  // (frame gaps from ADC drops, the polled source or a trace)
+  closeFinishedPunches(timeUs);
+  for (size_t ch = 0; ch < channelCount; ch++) {
+    processChannel(ch, millivolts[ch], timeUs);
+  }
+
+  closeFinishedPunches(timeUs);
+  return completedCount > 0;
+}
+
+void FSRPunchDetector::calibrateFrame(const uint16_t* millivolts, uint64_t timeUs) {
+  if (!calibrationStarted) {
+    calibrationStarted = true;
+    calibrationEndUs = timeUs + calibrationDurationUs;
+    for (size_t ch = 0; ch < channelCount; ch++) {
+      channels[ch].baseline.beginCalibration();
     }
   }
-  fsrValue = maxReading;
+  for (size_t ch = 0; ch < channelCount; ch++) {
+    channels[ch].baseline.addCalibrationSample(millivolts[ch]);
+  }
+  if (timeUs >= calibrationEndUs) {
+    for (size_t ch = 0; ch < channelCount; ch++) {
+      channels[ch].baseline.endCalibration();
+    }
+    calibrating = false;
+  }
+}
+
+void FSRPunchDetector::startPulse(size_t channel, uint16_t mv, uint64_t timeUs) {
+  uint8_t bit = (uint8_t)(1 << channel);
+  int slot = -1;
 
-  // If we detect a new hit above sensitivity
-  if (maxReading > fsrSensitivity && !isPressed) {
-    if (now - lastPunchTime > debounceDelay) {
-      isPressed = true;
-      lastPunchTime = now;
-      return true;
+  // Join a punch that started within the coincidence window
+  for (size_t i = 0; i < channelCount; i++) {
+    if (openPunches[i].active && timeUs - openPunches[i].event.onsetUs <= kCoincidenceUs) {
+      slot = i;
+      break;
     }
   }
-  // Reset when reading drops below threshold
-  else if (maxReading < fsrThreshold && isPressed) {
-    isPressed = false;
+  // Otherwise open a new one
+  if (slot < 0) {
+    int oldest = -1;
+    for (size_t i = 0; i < channelCount; i++) {
+      if (!openPunches[i].active) {
+        slot = i;
+        break;
+      }
+      if (oldest < 0 || openPunches[i].event.onsetUs < openPunches[oldest].event.onsetUs) {
+        oldest = i;
+      }
+    }
+    if (slot < 0) {
+      // Every slot taken: report the oldest punch with what it has so far
+      completePunch(oldest, timeUs);
+      slot = oldest;
+    }
+    OpenPunch& punch = openPunches[slot];
+    punch.active = true;
+    punch.pendingMask = 0;
+    punch.event = {};
+    punch.event.onsetUs = timeUs;
+    punch.event.timeMs = (unsigned long)(timeUs / 1000);
+    punch.event.forceCalibrated = true;
   }
 
-  return false;
+  OpenPunch& punch = openPunches[slot];
+  punch.event.zoneMask |= bit;
+  punch.pendingMask |= bit;
+  channels[channel].punchSlot = slot;
+  channels[channel].pulse.start(mv, timeUs);
 }
 
-String FSRPunchDetector::getPunchDetails(unsigned long elapsedMilliseconds) {
-  String details = "";
+void FSRPunchDetector::endPulse(size_t channel) {
+  ChannelState& state = channels[channel];
+  uint64_t padOnsetUs = state.pulse.getOnsetUs();
+  PulseFeatures pad = state.pulse.finish();
+  if (state.punchSlot < 0) {
+    return;
+  }
+
+  OpenPunch& punch = openPunches[state.punchSlot];
+  PulseFeatures& total = punch.event.features;
+  uint32_t padOffsetUs = (uint32_t)(padOnsetUs - punch.event.onsetUs);
+
+  punch.event.peakMv[channel] = pad.peakMv;
+  if (pad.peakMv > total.peakMv) {
+    total.peakMv = pad.peakMv;
+    total.timeToPeakUs = padOffsetUs + pad.timeToPeakUs;
+  }
+  if (padOffsetUs + pad.widthUs > total.widthUs) {
+    total.widthUs = padOffsetUs + pad.widthUs;
+  }
+  total.impulse += pad.impulse;
 
-  sensorVoltage = fsrValue / 1000.0;
-  float R_FSR = 0.0;  // Optional: calculate resistance if needed
+  const ForceCurve& curve = forceCurves[channel];
+  if (curve.isCalibrated()) {
+    uint32_t force = (uint32_t)punch.event.forceDn + curve.forceDn(pad.peakMv);
+    punch.event.forceDn = force > 0xFFFF ? 0xFFFF : (uint16_t)force;
+  } else {
+    punch.event.forceCalibrated = false;
+  }
 
-  calculateResults(fsrValue, R_FSR, elapsedMilliseconds, details);
-  details = "Punch Count: " + String(punchCount) + " " + details;
-  return details;
+  punch.pendingMask &= (uint8_t)~(1 << channel);
+  state.punchSlot = -1;
 }
 
-void FSRPunchDetector::calculateResults(int fsrSensorValue,
-                                        float R_FSR,
-                                        unsigned long punchTimestamp,
-                                        String& outputMessage) {
-  unsigned long minutes = punchTimestamp / 60000;
-  unsigned long seconds = (punchTimestamp % 60000) / 1000;
-  unsigned long hundredths = (punchTimestamp % 1000) / 10;
+void FSRPunchDetector::closeFinishedPunches(uint64_t timeUs) {
+  for (size_t i = 0; i < channelCount; i++) {
+    OpenPunch& punch = openPunches[i];
+    // Keep the window open so a late second pad can still join
+    if (!punch.active || punch.pendingMask != 0 || timeUs - punch.event.onsetUs <= kCoincidenceUs) {
+      continue;
+    }
+    completePunch(i, timeUs);
+  }
+}
 
-  char timestampFormatted[12];
-  sprintf(timestampFormatted, "%02lu:%02lu:%02lu", minutes, seconds, hundredths);
+void FSRPunchDetector::completePunch(size_t slot, uint64_t timeUs) {
+  OpenPunch& punch = openPunches[slot];
+  // Pads still held keep their pulse but no longer add to this punch
+  for (size_t ch = 0; ch < channelCount; ch++) {
+    if (channels[ch].punchSlot == (int8_t)slot) {
+      channels[ch].punchSlot = -1;
+    }
+  }
+  punch.active = false;
+  punch.pendingMask = 0;
+  punch.event.completedUs = timeUs;
+  if (completedCount < kMaxChannels) {
+    completed[(completedHead + completedCount) % kMaxChannels] = punch.event;
+    completedCount++;
+  }
+}
+
+unsigned long FSRPunchDetector::getLastPunchTime() {
+  return lastPunchTime;
+}
+
+const PunchEvent& FSRPunchDetector::getLastPunch() {
+  return lastPunch;
+}
+
+size_t FSRPunchDetector::getPunchDetails(uint64_t elapsedMicros, char* out, size_t outSize) {
+  int prefix = snprintf(out, outSize, "Punch Count: %d ", punchCount);
+  if (prefix < 0 || (size_t)prefix >= outSize) {
+    return 0;
+  }
+  size_t length = prefix + calculateResults(fsrValue, (unsigned long)(elapsedMicros / 1000ULL),
+                                            lastPunch.zoneMask, out + prefix, outSize - prefix);
+  if (length + 1 < outSize) {
+    // Full-resolution round time after the mm:ss:hh the app already parses
+    const PulseFeatures& features = lastPunch.features;
+    int written = snprintf(out + length, outSize - length,
+                           " | Time us: %llu | Rise us: %lu | Width us: %lu | Impulse: %lu",
+                           (unsigned long long)elapsedMicros,
+                           (unsigned long)features.timeToPeakUs,
+                           (unsigned long)features.widthUs,
+                           (unsigned long)features.impulse);
+    if (written > 0) {
+      length += (size_t)written < outSize - length ? written : outSize - length - 1;
+    }
+  }
+  if (lastPunch.forceCalibrated && length + 1 < outSize) {
+    int written = snprintf(out + length, outSize - length, " | Force N: %u.%u",
+                           (unsigned)(lastPunch.forceDn / 10), (unsigned)(lastPunch.forceDn % 10));
+    if (written > 0) {
+      length += (size_t)written < outSize - length ? written : outSize - length - 1;
+    }
+  }
+  return length;
+}
 
-  outputMessage += "Timestamp: " + String(timestampFormatted)
-                   + " Device: " + DEVICE_NAME
-                   + " | Sensor millivolts: " + String(fsrSensorValue);
+size_t FSRPunchDetector::getPunchFrame(uint32_t elapsedMicros, uint16_t seq, uint8_t* out, size_t outSize) {
+  PunchFrame frame;
+  frame.device = punchDeviceFromName(deviceName);
+  frame.seq = seq;
+  frame.punchCount = (uint16_t)punchCount;
+  frame.timeUs = elapsedMicros;
+  frame.peakMv = (uint16_t)fsrValue;
+  frame.zoneMask = lastPunch.zoneMask;
+  frame.flags = lastPunch.forceCalibrated ? kPunchFlagForceCalibrated : 0;
+  frame.forceDn = lastPunch.forceDn;
+  return encodePunchFrame(frame, out, outSize);
 }
 
-float FSRPunchDetector::getSensorVoltage() {
-  return sensorVoltage;
+size_t FSRPunchDetector::calculateResults(int fsrSensorValue,
+                                          unsigned long punchTimestamp,
+                                          uint8_t zoneMask,
+                                          char* out,
+                                          size_t outSize) {
+  unsigned long minutes = punchTimestamp / 60000;
+  unsigned long seconds = (punchTimestamp % 60000) / 1000;
+  unsigned long hundredths = (punchTimestamp % 1000) / 10;
+
+  int written = snprintf(out, outSize,
+                         "Timestamp: %02lu:%02lu:%02lu Device: %s | Sensor millivolts: %d | Zone: %u",
+                         minutes, seconds, hundredths, deviceName, fsrSensorValue, (unsigned)zoneMask);
+  if (written < 0) {
+    return 0;
+  }
+  return (size_t)written < outSize ? written : outSize - 1;
 }
 
 void FSRPunchDetector::setSensitivity(int value) {
@@ -106,6 +311,49 @@ int FSRPunchDetector::getThreshold() {
   return fsrThreshold;
 }
 
+void FSRPunchDetector::setDeviceName(const char* name) {
+  deviceName = name;
+}
+
+void FSRPunchDetector::setAdaptive(bool enabled) {
+  adaptive = enabled;
+}
+
+bool FSRPunchDetector::isAdaptive() {
+  return adaptive;
+}
+
+void FSRPunchDetector::startCalibration(unsigned long durationMs) {
+  resetState();
+  calibrationDurationUs = (uint64_t)durationMs * 1000ULL;
+  calibrationStarted = false;
+  calibrating = true;
+}
+
+bool FSRPunchDetector::isCalibrating() {
+  return calibrating;
+}
+
+size_t FSRPunchDetector::getChannelCount() {
+  return channelCount;
+}
+
+bool FSRPunchDetector::setForceCurve(size_t channel, const ForcePoint* points, size_t count) {
+  return channel < kMaxChannels && forceCurves[channel].set(points, count);
+}
+
+const ForceCurve& FSRPunchDetector::getForceCurve(size_t channel) {
+  return forceCurves[channel < kMaxChannels ? channel : 0];
+}
+
+uint16_t FSRPunchDetector::getBaselineMv(size_t channel) {
+  return channel < kMaxChannels ? channels[channel].baseline.getBaselineMv() : 0;
+}
+
+uint16_t FSRPunchDetector::getNoiseMv(size_t channel) {
+  return channel < kMaxChannels ? channels[channel].baseline.getNoiseMv() : 0;
+}
+
 void FSRPunchDetector::increasePunch() {
   punchCount++;
 }
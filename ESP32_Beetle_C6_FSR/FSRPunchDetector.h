@@ -2,49 +2,249 @@
 #ifndef FSR_PUNCH_DETECTOR_H
 #define FSR_PUNCH_DETECTOR_H
 
-#include <Arduino.h>
+#include <array>
 #include <vector>
 #include <initializer_list>
+#include "Hal.h"
+#include "PulseTracker.h"
+#include "BaselineTracker.h"
+#include "PunchFrame.h"
+#include "ForceCalibration.h"
 
+// One detected punch, reported once every pad it hit has been released.
+// Pads whose trigger fired within the coincidence window of the first one
+// belong to the same punch.
+struct PunchEvent {
+  unsigned long timeMs;                   // onset of the first pad that fired
+  uint64_t onsetUs;
+  uint64_t completedUs;                   // sample that completed the punch
+  uint8_t zoneMask;                       // bit n set: pad n was hit
+  uint16_t peakMv[kMaxAnalogChannels];    // per pad, 0 for pads not hit
+  PulseFeatures features;                 // whole punch: strongest peak, summed impulse
+  uint16_t forceDn;                       // 0.1 N, summed over the calibrated pads hit
+  bool forceCalibrated;                   // every pad hit has a force curve
+};
+
+// Runtime-configured detector: any pin list up to kMaxAnalogChannels,
+// channel count known only once the source is attached. Builds with a
+// fixed pad set use FixedPunchDetector (FixedPunchDetector.h), which
+// shares everything here but the per-frame loop: checkPunch() and
+// processFrame() are virtual, so it runs behind this interface too.
 class FSRPunchDetector {
-private:
+protected:
+  static const size_t kBlockFrames = 32;
+  static const uint64_t kDebounceUs = 200000;     // per pad, between punches
+  static const uint64_t kCoincidenceUs = 20000;   // pads firing this close are one punch
+  static const uint64_t kMaxPulseUs = 500000;     // a pad held longer than this ends its pulse
+  static const int kTriggerNoiseFactor = 8;       // adaptive trigger: at least 8x noise over baseline
+  static const int kReleaseNoiseFactor = 4;       // adaptive release: at least 4x noise over baseline
+
+  // Independent hysteresis / refractory state and pulse of each pad
+  struct ChannelState {
+    bool isPressed;
+    bool hasTriggered;  // lastTriggerUs is valid; the first hit is never debounced
+    uint64_t lastTriggerUs;
+    int8_t punchSlot;  // open punch this pad's pulse belongs to, -1 if none
+    PulseTracker pulse;
+    BaselineTracker baseline;
+  };
+
+  // Punch still collecting pulses
+  struct OpenPunch {
+    bool active;
+    uint8_t pendingMask;  // pads whose pulse has not ended yet
+    PunchEvent event;
+  };
+
   std::vector<int> fsrPins;
+  size_t channelCount;  // pins actually delivered by the source
   int fsrSensitivity;
   int fsrThreshold;
-  bool isPressed;
+  bool adaptive;  // thresholds relative to each pad's tracked baseline
+  bool calibrating;
+  bool calibrationStarted;
+  uint64_t calibrationDurationUs;
+  uint64_t calibrationEndUs;
+  std::array<ChannelState, kMaxAnalogChannels> channels;
+  std::array<OpenPunch, kMaxAnalogChannels> openPunches;  // at most one per pad
+  std::array<PunchEvent, kMaxAnalogChannels> completed;   // finished punches not yet taken
+  std::array<ForceCurve, kMaxAnalogChannels> forceCurves;
+  size_t completedHead;
+  size_t completedCount;
+  PunchEvent lastPunch;
   int punchCount;
-  int punchPower;
-  float sensorVoltage;
   int fsrValue;
   unsigned long lastPunchTime;
+  const char* deviceName;
+
+  // Block of frames pulled from the analog source, consumed by checkPunch()
+  AnalogSource* source;
+  Logger* logger;
+  uint16_t block[kBlockFrames][kMaxAnalogChannels];
+  uint64_t blockTimes[kBlockFrames];
+  size_t blockLength;
+  size_t blockPosition;
 
 public:
+  static const uint8_t kMaxChannels = kMaxAnalogChannels;  // extra pins are ignored
+
   // Now takes a list of pins + sensitivity + threshold
   FSRPunchDetector(const std::initializer_list<int>& pins,
                    int sensitivity,
                    int threshold);
+  virtual ~FSRPunchDetector() {}
 
-  void setup();
-  bool checkPunch();
+  void setup(AnalogSource* analogSource, Logger* log);
+  // Consumes sampled frames from the analog source until a punch completes;
+  // the punch is then available from getLastPunch(). Call again until it
+  // returns false to drain everything pending.
+  virtual bool checkPunch();
+  // Feeds one sampled frame (mV per pin, in pin order) captured at timeUs.
+  // Returns true while completed punches are waiting for checkPunch().
+  virtual bool processFrame(const uint16_t* millivolts, uint64_t timeUs);
+  unsigned long getLastPunchTime();
+  const PunchEvent& getLastPunch();
+  void discardPending();
 
-  float getSensorVoltage();
-  int   getFsrValue();
+  int   getFsrValue();  // peak of the last punch, mV
 
   void  setSensitivity(int value);
   int   getSensitivity();
   void  setThreshold(int value);
   int   getThreshold();
+  void  setDeviceName(const char* name);
+
+  // Adaptive thresholds: trigger/release sit above each pad's baseline by
+  // the configured sensitivity/threshold or a multiple of its noise floor,
+  // whichever is larger.
+  void  setAdaptive(bool enabled);
+  bool  isAdaptive();
+  // Measures idle level and noise of every pad over the next durationMs of
+  // samples; no punches are detected meanwhile.
+  void  startCalibration(unsigned long durationMs);
+  bool  isCalibrating();
+  size_t getChannelCount();
+
+  // Per-pad mV -> force curves (ForceCalibration.h); punches then report
+  // force next to the raw peak. false when the points are rejected.
+  bool  setForceCurve(size_t channel, const ForcePoint* points, size_t count);
+  const ForceCurve& getForceCurve(size_t channel);
+  uint16_t getBaselineMv(size_t channel);
+  uint16_t getNoiseMv(size_t channel);
+  int   getTriggerMv(size_t channel);
+  int   getReleaseMv(size_t channel);
 
   void  increasePunch();
   int   getPunchCount();
   void  resetPunchCount();
-  String getPunchDetails(unsigned long elapsedMilliseconds);
+  // Formats the punch message into out; returns the message length.
+  size_t getPunchDetails(uint64_t elapsedMicros, char* out, size_t outSize);
+  // Encodes the punch as a binary PunchFrame; returns the frame length.
+  size_t getPunchFrame(uint32_t elapsedMicros, uint16_t seq, uint8_t* out, size_t outSize);
 
   // Internals for result formatting
-  void calculateResults(int fsrSensorValue,
-                        float R_FSR,
-                        unsigned long punchTimestamp,
-                        String &outputMessage);
+  size_t calculateResults(int fsrSensorValue,
+                          unsigned long punchTimestamp,
+                          uint8_t zoneMask,
+                          char* out,
+                          size_t outSize);
+
+protected:
+  // Per-frame steps shared with FixedPunchDetector
+  inline bool takeCompleted();
+  inline bool nextFrame(const uint16_t*& millivolts, uint64_t& timeUs);
+  inline void processChannel(size_t channel, int mv, uint64_t timeUs);
+  void startPulse(size_t channel, uint16_t mv, uint64_t timeUs);
+  void endPulse(size_t channel);
+  void closeFinishedPunches(uint64_t timeUs);
+  void completePunch(size_t slot, uint64_t timeUs);
+  void calibrateFrame(const uint16_t* millivolts, uint64_t timeUs);
+  void resetState();
 };
 
+// Moves the oldest finished punch to lastPunch.
+inline bool FSRPunchDetector::takeCompleted() {
+  if (completedCount == 0) {
+    return false;
+  }
+  lastPunch = completed[completedHead];
+  completedHead = (completedHead + 1) % kMaxChannels;
+  completedCount--;
+  lastPunchTime = lastPunch.timeMs;
+  fsrValue = lastPunch.features.peakMv;
+  return true;
+}
+
+// Next frame of the current block, refilled from the source when used up.
+inline bool FSRPunchDetector::nextFrame(const uint16_t*& millivolts, uint64_t& timeUs) {
+  if (source == nullptr) {
+    return false;
+  }
+  if (blockPosition >= blockLength) {
+    blockLength = source->readFrames(block, blockTimes, kBlockFrames);
+    blockPosition = 0;
+    if (blockLength == 0) {
+      return false;
+    }
+  }
+  size_t i = blockPosition++;
+  millivolts = block[i];
+  timeUs = blockTimes[i];
+  return true;
+}
+
+// Hysteresis, refractory period and pulse tracking of one pad for one
+// sample. Inline so the unrolled loop of FixedPunchDetector folds it in.
+inline void FSRPunchDetector::processChannel(size_t channel, int mv, uint64_t timeUs) {
+  ChannelState& state = channels[channel];
+
+  // If we detect a new hit above sensitivity on this pad
+  if (!state.isPressed) {
+    if (mv > getTriggerMv(channel) && (!state.hasTriggered || timeUs - state.lastTriggerUs > kDebounceUs)) {
+      state.isPressed = true;
+      state.hasTriggered = true;
+      state.lastTriggerUs = timeUs;
+      startPulse(channel, mv, timeUs);
+    } else if (adaptive) {
+      state.baseline.update(mv);  // idle pad: follow drift
+    }
+    return;
+  }
+
+  if (state.pulse.isActive()) {
+    state.pulse.add(mv, timeUs);
+  }
+  // Reset when this pad drops below threshold
+  if (mv < getReleaseMv(channel)) {
+    state.isPressed = false;
+    if (state.pulse.isActive()) {
+      endPulse(channel);
+    }
+  } else if (state.pulse.isActive()) {
+    if (timeUs - state.pulse.getOnsetUs() > kMaxPulseUs) {
+      endPulse(channel);  // leaning on the pad: close the hit
+    }
+  } else if (adaptive) {
+    state.baseline.follow(mv);  // still held: the held level becomes the floor
+  }
+}
+
+inline int FSRPunchDetector::getTriggerMv(size_t channel) {
+  if (!adaptive || channel >= kMaxChannels) {
+    return fsrSensitivity;
+  }
+  const BaselineTracker& baseline = channels[channel].baseline;
+  int noiseMargin = baseline.getNoiseMv() * kTriggerNoiseFactor;
+  return baseline.getBaselineMv() + (noiseMargin > fsrSensitivity ? noiseMargin : fsrSensitivity);
+}
+
+inline int FSRPunchDetector::getReleaseMv(size_t channel) {
+  if (!adaptive || channel >= kMaxChannels) {
+    return fsrThreshold;
+  }
+  const BaselineTracker& baseline = channels[channel].baseline;
+  int noiseMargin = baseline.getNoiseMv() * kReleaseNoiseFactor;
+  return baseline.getBaselineMv() + (noiseMargin > fsrThreshold ? noiseMargin : fsrThreshold);
+}
+
 #endif  // FSR_PUNCH_DETECTOR_H
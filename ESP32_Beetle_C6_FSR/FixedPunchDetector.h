@@ -0,0 +1,58 @@
+// FixedPunchDetector.h
+#ifndef FIXED_PUNCH_DETECTOR_H
+#define FIXED_PUNCH_DETECTOR_H
+
+#include <utility>
+#include "FSRPunchDetector.h"
+
+// FSRPunchDetector for a pad set fixed at compile time, e.g.
+// FixedPunchDetector<4, 5, 6> for the three-pad bag. Thresholds,
+// calibration and reporting are the runtime class's; only the per-frame
+// loop differs: its bound is a constant and it is unrolled into one
+// inlined step per pad, so a 1-pad build pays for one pad and no loop.
+//
+// checkPunch()/processFrame() override the base versions, so the
+// unrolled loop runs behind an FSRPunchDetector pointer as well; within
+// one checkPunch() the frames go to processFrame() without a virtual
+// call. The source is still read through AnalogSource, once per block.
+template <int... Pins>
+class FixedPunchDetector final : public FSRPunchDetector {
+public:
+  static const size_t kChannels = sizeof...(Pins);
+  static_assert(kChannels >= 1 && kChannels <= kMaxAnalogChannels, "1 to kMaxAnalogChannels pins");
+
+  FixedPunchDetector(int sensitivity, int threshold)
+    : FSRPunchDetector({ Pins... }, sensitivity, threshold) {}
+
+  bool checkPunch() override {
+    const uint16_t* millivolts;
+    uint64_t timeUs;
+    while (!takeCompleted()) {
+      if (!nextFrame(millivolts, timeUs)) {
+        return false;
+      }
+      FixedPunchDetector::processFrame(millivolts, timeUs);
+    }
+    return true;
+  }
+
+  // Every one of the kChannels pads is processed; one the source does not
+  // deliver reads 0 mV (see setup()) and never fires.
+  bool processFrame(const uint16_t* millivolts, uint64_t timeUs) override {
+    if (calibrating) {
+      return FSRPunchDetector::processFrame(millivolts, timeUs);
+    }
+    closeFinishedPunches(timeUs);
+    processChannels(millivolts, timeUs, std::make_index_sequence<kChannels>());
+    closeFinishedPunches(timeUs);
+    return completedCount > 0;
+  }
+
+private:
+  template <size_t... Channel>
+  void processChannels(const uint16_t* millivolts, uint64_t timeUs, std::index_sequence<Channel...>) {
+    (processChannel(Channel, millivolts[Channel], timeUs), ...);
+  }
+};
+
+#endif  // FIXED_PUNCH_DETECTOR_H
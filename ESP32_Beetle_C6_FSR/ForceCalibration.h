@@ -0,0 +1,132 @@
+// ForceCalibration.h
+#ifndef FORCE_CALIBRATION_H
+#define FORCE_CALIBRATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One reference weight on one pad: the divider output it produced and the
+// force it stands for, in 0.1 N (deciNewton) so the firmware stays integer.
+struct ForcePoint {
+  uint16_t mv;
+  uint16_t forceDn;
+};
+
+// Piecewise-linear mV -> force curve of one pad, built from a few
+// reference weights. The curve starts at (0 mV, 0 N), runs through the
+// points and continues along its last segment. Slopes are precomputed in
+// Q16 and a 64 mV bucket table names the segment each bucket starts in;
+// with knots at least one bucket apart a lookup is one table read, at
+// most one compare and a multiply. Integer math only.
+class ForceCurve {
+public:
+  static const size_t kMaxPoints = 8;
+  static const uint16_t kMinSpacingMv = 64;  // one bucket
+
+  ForceCurve() {
+    clear();
+  }
+
+  void clear() {
+    pointCount = 0;
+    knotCount = 0;
+  }
+
+  // Points in increasing mV with non-decreasing force, at least
+  // kMinSpacingMv apart (from 0 mV too, unless the first point is at 0).
+  // Returns false and keeps the current curve when they are not; an empty
+  // list clears it.
+  bool set(const ForcePoint* newPoints, size_t count) {
+    if (count > kMaxPoints) {
+      return false;
+    }
+    uint16_t lastMv = 0;
+    uint16_t lastForce = 0;
+    for (size_t i = 0; i < count; i++) {
+      bool atOrigin = i == 0 && newPoints[i].mv == 0;
+      if (!atOrigin && newPoints[i].mv < lastMv + kMinSpacingMv) {
+        return false;
+      }
+      if (newPoints[i].forceDn < lastForce) {
+        return false;
+      }
+      lastMv = newPoints[i].mv;
+      lastForce = newPoints[i].forceDn;
+    }
+
+    clear();
+    for (size_t i = 0; i < count; i++) {
+      points[i] = newPoints[i];
+    }
+    pointCount = (uint8_t)count;
+    if (count == 0) {
+      return true;
+    }
+
+    if (points[0].mv != 0) {
+      knots[knotCount++] = { 0, 0 };
+    }
+    for (size_t i = 0; i < count; i++) {
+      knots[knotCount++] = points[i];
+    }
+    if (knotCount == 1) {  // a single point at 0 mV: flat
+      knots[knotCount++] = { kMinSpacingMv, points[0].forceDn };
+    }
+    for (size_t i = 0; i + 1 < knotCount; i++) {
+      slopeQ16[i] = (int32_t)(((int64_t)(knots[i + 1].forceDn - knots[i].forceDn) << 16) /
+                              (knots[i + 1].mv - knots[i].mv));
+    }
+    size_t segment = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+      uint32_t bucketMv = (uint32_t)bucket << kBucketShift;
+      while (segment + 2 < knotCount && bucketMv >= knots[segment + 1].mv) {
+        segment++;
+      }
+      bucketSegment[bucket] = (uint8_t)segment;
+    }
+    return true;
+  }
+
+  bool isCalibrated() const {
+    return pointCount > 0;
+  }
+
+  size_t getPointCount() const {
+    return pointCount;
+  }
+
+  const ForcePoint& getPoint(size_t index) const {
+    return points[index];
+  }
+
+  // 0.1 N at the given divider output, saturating; 0 when uncalibrated.
+  uint16_t forceDn(uint16_t mv) const {
+    if (knotCount == 0) {
+      return 0;
+    }
+    size_t bucket = mv >> kBucketShift;
+    size_t segment = bucketSegment[bucket < kBuckets ? bucket : kBuckets - 1];
+    if (segment + 2 < knotCount && mv >= knots[segment + 1].mv) {
+      segment++;
+    }
+    int64_t force = knots[segment].forceDn +
+                    (((int64_t)slopeQ16[segment] * (mv - knots[segment].mv)) >> 16);
+    if (force < 0) {
+      return 0;
+    }
+    return force > 0xFFFF ? 0xFFFF : (uint16_t)force;
+  }
+
+private:
+  static const int kBucketShift = 6;    // 64 mV buckets
+  static const size_t kBuckets = 64;    // 0..4095 mV; the ADC tops out near 3300
+
+  ForcePoint points[kMaxPoints];        // as uploaded
+  ForcePoint knots[kMaxPoints + 1];     // points behind the origin
+  int32_t slopeQ16[kMaxPoints];         // 0.1 N per mV, Q16, per segment
+  uint8_t bucketSegment[kBuckets];
+  uint8_t pointCount;
+  uint8_t knotCount;
+};
+
+#endif  // FORCE_CALIBRATION_H
@@ -0,0 +1,55 @@
+// ForceStore.cpp
+#include "ForceStore.h"
+#include <Preferences.h>
+#include "AsyncLog.h"
+
+static const char* const kForceNamespace = "boxing";
+
+static void forceKey(size_t channel, char* out, size_t outSize) {
+  snprintf(out, outSize, "force%u", (unsigned)channel);
+}
+
+void loadForceCurves(FSRPunchDetector& detector) {
+  Preferences prefs;
+  if (!prefs.begin(kForceNamespace, true)) {
+    return;  // nothing stored yet
+  }
+  char key[12];
+  ForcePoint points[ForceCurve::kMaxPoints];
+  for (size_t ch = 0; ch < FSRPunchDetector::kMaxChannels; ch++) {
+    forceKey(ch, key, sizeof(key));
+    size_t length = prefs.getBytesLength(key);
+    if (length == 0 || length % sizeof(ForcePoint) != 0 || length > sizeof(points)) {
+      continue;
+    }
+    prefs.getBytes(key, points, length);
+    if (!detector.setForceCurve(ch, points, length / sizeof(ForcePoint))) {
+      LOG_WARN("Force: stored curve of pad %u rejected", (unsigned)ch);
+    }
+  }
+  prefs.end();
+}
+
+bool storeForceCurve(size_t channel, const ForceCurve& curve) {
+  Preferences prefs;
+  if (!prefs.begin(kForceNamespace, false)) {
+    LOG_WARN("Force: NVS not available");
+    return false;
+  }
+  char key[12];
+  forceKey(channel, key, sizeof(key));
+  bool stored;
+  if (!curve.isCalibrated()) {
+    stored = !prefs.isKey(key) || prefs.remove(key);
+  } else {
+    ForcePoint points[ForceCurve::kMaxPoints];
+    size_t count = curve.getPointCount();
+    for (size_t i = 0; i < count; i++) {
+      points[i] = curve.getPoint(i);
+    }
+    size_t length = count * sizeof(ForcePoint);
+    stored = prefs.putBytes(key, points, length) == length;
+  }
+  prefs.end();
+  return stored;
+}
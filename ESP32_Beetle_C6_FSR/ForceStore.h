@@ -0,0 +1,15 @@
+// ForceStore.h
+#ifndef FORCE_STORE_H
+#define FORCE_STORE_H
+
+#include <stddef.h>
+#include "FSRPunchDetector.h"
+
+// Force curves of the pads, kept in NVS (namespace "boxing", one key per
+// pad: "force0".."force5") as the uploaded reference points. The curves
+// are rebuilt from them at boot, slopes and buckets included.
+void loadForceCurves(FSRPunchDetector& detector);
+// Stores the points of one pad; an empty curve erases the key.
+bool storeForceCurve(size_t channel, const ForceCurve& curve);
+
+#endif  // FORCE_STORE_H
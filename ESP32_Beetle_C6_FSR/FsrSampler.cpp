@@ -0,0 +1,181 @@
+// FsrSampler.cpp
+#include "FsrSampler.h"
+#include <esp_timer.h>
+#include "AsyncLog.h"
+
+FsrSampler* FsrSampler::activeInstance = nullptr;
+
+FsrSampler::FsrSampler(const std::initializer_list<int>& pinList, uint32_t rateHz)
+  : sampleRateHz(rateHz),
+    running(false),
+    samplerTask(nullptr),
+    listenerTask(nullptr),
+    droppedBefore(0),
+    lostInDriver(0),
+    stampHead(0),
+    stampTail(0),
+    lastStampUs(0) {
+  for (auto pin : pinList) {
+    if (pins.size() < kMaxChannels) {
+      pins.push_back((uint8_t)pin);
+    }
+  }
+}
+
+bool FsrSampler::begin() {
+  if (running) {
+    return true;
+  }
+
+  if (samplerTask == nullptr) {
+    // Above the Arduino loop task (1) so BLE/JSON work never starves sampling.
+    xTaskCreate(samplerTaskEntry, "fsrSampler", 3072, this, 5, &samplerTask);
+  }
+
+  activeInstance = this;
+  // One conversion per pin per frame: every DMA frame is one sample per channel.
+  uint32_t conversionRate = sampleRateHz * pins.size();
+  if (!analogContinuous(pins.data(), pins.size(), 1, conversionRate, &FsrSampler::onConversionDone)) {
+    LOG_ERROR("FSR Sampler: continuous ADC setup failed.");
+    activeInstance = nullptr;
+    return false;
+  }
+
+  droppedBefore += ring.dropped();
+  ring.clear();
+  stampTail.store(stampHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+  lastStampUs = esp_timer_get_time();
+  if (!analogContinuousStart()) {
+    LOG_ERROR("FSR Sampler: continuous ADC start failed.");
+    analogContinuousDeinit();
+    activeInstance = nullptr;
+    return false;
+  }
+
+  running = true;
+  LOG_INFO("FSR Sampler started at %lu Hz per channel.", (unsigned long)sampleRateHz);
+  return true;
+}
+
+void FsrSampler::end() {
+  if (!running) {
+    return;
+  }
+  running = false;  // before the driver goes: the sampler task stops reading it
+  analogContinuousStop();
+  analogContinuousDeinit();
+  activeInstance = nullptr;
+}
+
+bool FsrSampler::isRunning() {
+  return running;
+}
+
+void FsrSampler::setSampleRate(uint32_t rateHz) {
+  if (rateHz == 0 || rateHz == sampleRateHz) {
+    return;
+  }
+  sampleRateHz = rateHz;
+  if (running) {
+    end();
+    begin();
+  }
+}
+
+uint32_t FsrSampler::getSampleRate() {
+  return sampleRateHz;
+}
+
+uint8_t FsrSampler::channelCount() {
+  return pins.size();
+}
+
+size_t FsrSampler::readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                              uint64_t* timesUs,
+                              size_t maxFrames) {
+  return ring.pop(out, timesUs, maxFrames);
+}
+
+void FsrSampler::discardPending() {
+  ring.discard();
+}
+
+uint32_t FsrSampler::getDroppedFrames() {
+  return droppedBefore + ring.dropped() + lostInDriver.load(std::memory_order_relaxed);
+}
+
+void FsrSampler::setListener(TaskHandle_t task) {
+  listenerTask = task;
+}
+
+// Runs in ISR context: stamp the frame and wake the sampler task. With
+// one conversion per pin, every callback is one frame.
+void ARDUINO_ISR_ATTR FsrSampler::onConversionDone() {
+  FsrSampler* self = activeInstance;
+  if (self == nullptr || self->samplerTask == nullptr) {
+    return;
+  }
+  uint32_t head = self->stampHead.load(std::memory_order_relaxed);
+  if (head - self->stampTail.load(std::memory_order_acquire) < kStampSlots) {
+    self->stampUs[head & (kStampSlots - 1)] = esp_timer_get_time();
+    self->stampHead.store(head + 1, std::memory_order_release);
+  }
+  BaseType_t higherPriorityWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(self->samplerTask, &higherPriorityWoken);
+  portYIELD_FROM_ISR(higherPriorityWoken);
+}
+
+void FsrSampler::samplerTaskEntry(void* arg) {
+  FsrSampler* self = static_cast<FsrSampler*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->drainAdc();
+  }
+}
+
+// Capture time of the oldest unread frame. The ISR stamp queue can only
+// run dry if it overflowed; those frames get the nominal period.
+uint64_t FsrSampler::takeStamp() {
+  uint32_t tail = stampTail.load(std::memory_order_relaxed);
+  if (stampHead.load(std::memory_order_acquire) == tail) {
+    lastStampUs += 1000000UL / sampleRateHz;
+    return lastStampUs;
+  }
+  lastStampUs = stampUs[tail & (kStampSlots - 1)];
+  stampTail.store(tail + 1, std::memory_order_release);
+  return lastStampUs;
+}
+
+void FsrSampler::drainAdc() {
+  adc_continuous_data_t* result = nullptr;
+  uint16_t frame[kMaxChannels] = { 0 };
+  bool pushed = false;
+
+  // Several DMA frames may be pending if the task was delayed; take them all.
+  uint64_t drainedUs;
+  for (;;) {
+    drainedUs = esp_timer_get_time();
+    if (!running || !analogContinuousRead(&result, 0)) {
+      break;
+    }
+    for (size_t ch = 0; ch < pins.size(); ch++) {
+      frame[ch] = (uint16_t)result[ch].avg_read_mv;
+    }
+    ring.push(frame, takeStamp());
+    pushed = true;
+  }
+
+  // The driver pool is empty, so stamps from before the last read belong
+  // to frames it overwrote: count them, so later frames keep their own time.
+  uint32_t tail = stampTail.load(std::memory_order_relaxed);
+  uint32_t head = stampHead.load(std::memory_order_acquire);
+  while (tail != head && stampUs[tail & (kStampSlots - 1)] < drainedUs) {
+    tail++;
+    lostInDriver.fetch_add(1, std::memory_order_relaxed);
+  }
+  stampTail.store(tail, std::memory_order_release);
+
+  if (pushed && listenerTask != nullptr) {
+    xTaskNotifyGive(listenerTask);
+  }
+}
@@ -0,0 +1,72 @@
+// FsrSampler.h
+#ifndef FSR_SAMPLER_H
+#define FSR_SAMPLER_H
+
+#include <Arduino.h>
+#include <vector>
+#include <atomic>
+#include <initializer_list>
+#include "Hal.h"
+#include "SampleRing.h"
+
+// Fixed-rate FSR sampler built on the ESP32 continuous (DMA) ADC driver.
+// A high-priority task drains completed DMA frames into a per-channel ring,
+// so the sample rate no longer depends on how busy BoxingApp::loop() is.
+class FsrSampler : public AnalogSource {
+public:
+  static const uint8_t kMaxChannels = kMaxAnalogChannels;
+  static const size_t kRingFrames = 512;  // ~250 ms of history at 2 kHz
+
+  FsrSampler(const std::initializer_list<int>& pins, uint32_t sampleRateHz);
+
+  bool begin() override;  // false if the continuous ADC could not be started
+  void end();
+  bool isRunning();
+
+  void setSampleRate(uint32_t sampleRateHz);  // per channel, restarts if running
+  uint32_t getSampleRate();
+  uint8_t channelCount() override;
+
+  // Drains up to maxFrames sampled frames, each stamped with the esp_timer
+  // time of its conversion-done interrupt.
+  size_t readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                    uint64_t* timesUs,
+                    size_t maxFrames) override;
+
+  void discardPending();  // skip frames captured while nobody was listening
+
+  // Frames lost since boot: ring full, or overwritten in the driver
+  // before the sampler task read them.
+  uint32_t getDroppedFrames();
+
+  // Task woken (xTaskNotifyGive) after every batch of frames lands in the
+  // ring, so the consumer can block instead of polling readFrames().
+  void setListener(TaskHandle_t task);
+
+private:
+  std::vector<uint8_t> pins;
+  static const size_t kStampSlots = 32;
+
+  uint32_t sampleRateHz;
+  std::atomic<bool> running;  // start/stop from the app tasks, read by the sampler task
+  TaskHandle_t samplerTask;
+  TaskHandle_t listenerTask;
+  SampleRing<kMaxChannels, kRingFrames> ring;
+  uint32_t droppedBefore;  // ring drops of earlier runs; begin() clears the ring
+  std::atomic<uint32_t> lostInDriver;
+
+  // Conversion-done times, pushed by the ISR and taken one per frame by
+  // the sampler task (single producer / single consumer).
+  uint64_t stampUs[kStampSlots];
+  std::atomic<uint32_t> stampHead;
+  std::atomic<uint32_t> stampTail;
+  uint64_t lastStampUs;
+
+  static FsrSampler* activeInstance;
+  static void onConversionDone();
+  static void samplerTaskEntry(void* arg);
+  void drainAdc();
+  uint64_t takeStamp();
+};
+
+#endif  // FSR_SAMPLER_H
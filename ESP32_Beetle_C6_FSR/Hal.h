@@ -0,0 +1,64 @@
+// Hal.h
+// Thin hardware abstraction used by the portable core (detector, timer,
+// round state machine). The firmware implements it in ArduinoHal.*, the
+// host build in host/HostHal.*.
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+static const uint8_t kMaxAnalogChannels = 6;
+
+// Monotonic time since boot.
+class Clock {
+public:
+  virtual ~Clock() {}
+  virtual unsigned long millis() = 0;
+  virtual unsigned long micros() = 0;
+  // Full 64-bit microsecond count; never wraps in practice.
+  virtual uint64_t micros64() = 0;
+};
+
+// Source of multi-channel FSR samples, in millivolts.
+class AnalogSource {
+public:
+  virtual ~AnalogSource() {}
+  virtual bool begin() = 0;
+  virtual uint8_t channelCount() = 0;
+  // Copies up to maxFrames frames into out[frame][channel] and the capture
+  // time of each frame (microseconds since boot) into timesUs. Returns the
+  // number of frames copied, 0 when nothing new is available.
+  virtual size_t readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                            uint64_t* timesUs,
+                            size_t maxFrames) = 0;
+};
+
+// Outbound link to the phone.
+class Transport {
+public:
+  virtual ~Transport() {}
+  virtual void sendMessage(const char* message) = 0;
+  virtual void sendBytes(const uint8_t* data, size_t length) = 0;
+  virtual bool isDeviceConnected() = 0;
+};
+
+// Line-oriented diagnostics output.
+class Logger {
+public:
+  virtual ~Logger() {}
+  virtual void log(const char* line) = 0;
+
+  void logf(const char* format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    log(line);
+  }
+};
+
+#endif  // HAL_H
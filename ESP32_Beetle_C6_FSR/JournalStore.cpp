@@ -0,0 +1,260 @@
+// JournalStore.cpp
+#include "JournalStore.h"
+#include <LittleFS.h>
+#include "AsyncLog.h"
+
+static const char* const kJournalDir = "/pj";
+
+// The writer collects punches for this long before appending them: one
+// flash sync per batch instead of one per punch.
+static const TickType_t kBatchTicks = pdMS_TO_TICKS(250);
+
+JournalStore::JournalStore()
+  : fsLock(nullptr),
+    writerTask(nullptr),
+    firstSegment(1),
+    lastSegment(1),
+    session(1),
+    ready(false) {}
+
+bool JournalStore::begin() {
+  if (!LittleFS.begin(true)) {
+    LOG_WARN("Journal: no LittleFS partition, punches are not journaled.");
+    return false;
+  }
+  if (!LittleFS.exists(kJournalDir)) {
+    LittleFS.mkdir(kJournalDir);
+  }
+  fsLock = xSemaphoreCreateMutex();
+
+  uint32_t oldest = 0;
+  uint32_t newest = 0;
+  bool stale = false;
+  File dir = LittleFS.open(kJournalDir);
+  for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+    uint32_t number = strtoul(entry.name(), nullptr, 10);
+    if (number == 0) {
+      continue;
+    }
+    if (entry.size() > 0 && entry.peek() != kJournalRecordMarker) {
+      stale = true;  // written by a firmware with another record format
+    }
+    if (oldest == 0 || number < oldest) {
+      oldest = number;
+    }
+    if (number > newest) {
+      newest = number;
+    }
+  }
+  dir.close();
+
+  // Records in an older format cannot be read back: drop them all and
+  // keep numbering after the newest segment
+  if (stale) {
+    char path[24];
+    for (uint32_t number = oldest; number != 0 && number <= newest; number++) {
+      segmentPath(number, path, sizeof(path));
+      LittleFS.remove(path);
+    }
+    LOG_WARN("Journal: dropped segments %lu..%lu in an older format",
+             (unsigned long)oldest, (unsigned long)newest);
+    oldest = newest + 1;
+  }
+
+  // A reset may have torn the last record of the newest segment, so this
+  // boot appends to a fresh one; readers stop at the torn record.
+  firstSegment = oldest != 0 ? oldest : 1;
+  lastSegment = newest + 1;
+
+  uint16_t lastSession;
+  session = findLastSession(lastSession) ? (uint16_t)(lastSession + 1) : 1;
+  if (session == 0) {
+    session = 1;
+  }
+  ready = true;
+  LOG_INFO("Journal: segments %lu..%lu, session %u",
+           (unsigned long)firstSegment, (unsigned long)newest, (unsigned)session);
+  return true;
+}
+
+void JournalStore::startWriterTask(UBaseType_t priority) {
+  if (ready && writerTask == nullptr) {
+    xTaskCreate(writerTaskEntry, "journal", 4096, this, priority, &writerTask);
+  }
+}
+
+bool JournalStore::isReady() {
+  return ready;
+}
+
+bool JournalStore::append(uint8_t round, const uint8_t* frame) {
+  if (writerTask == nullptr) {
+    return false;
+  }
+  JournalRecord record;
+  record.round = round;
+  record.session = session;
+  memcpy(record.frame, frame, kPunchFrameSize);
+  uint8_t encoded[kJournalRecordSize];
+  encodeJournalRecord(record, encoded, sizeof(encoded));
+  bool queued = pending.push((const char*)encoded, sizeof(encoded));
+  xTaskNotifyGive(writerTask);
+  return queued;
+}
+
+uint16_t JournalStore::getSession() {
+  return session;
+}
+
+uint32_t JournalStore::getDroppedRecords() {
+  return pending.getDroppedCommands();
+}
+
+uint32_t JournalStore::getSegmentCount() {
+  if (!ready) {
+    return 0;
+  }
+  xSemaphoreTake(fsLock, portMAX_DELAY);
+  uint32_t count = lastSegment - firstSegment + (segment ? 1 : 0);
+  xSemaphoreGive(fsLock);
+  return count;
+}
+
+JournalStore::Cursor JournalStore::first() {
+  Cursor cursor = { firstSegment, 0 };
+  return cursor;
+}
+
+size_t JournalStore::read(Cursor& cursor, uint8_t* out, size_t maxRecords) {
+  if (!ready || maxRecords == 0) {
+    return 0;
+  }
+  char path[24];
+  size_t records = 0;
+  xSemaphoreTake(fsLock, portMAX_DELAY);
+  while (records == 0 && cursor.segment <= lastSegment) {
+    if (cursor.segment < firstSegment) {  // deleted while we were reading
+      cursor.segment = firstSegment;
+      cursor.offset = 0;
+    }
+    segmentPath(cursor.segment, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    size_t length = 0;
+    if (file) {
+      file.seek(cursor.offset);
+      length = file.read(out, maxRecords * kJournalRecordSize);
+      file.close();
+    }
+    JournalRecord record;
+    while ((records + 1) * kJournalRecordSize <= length &&
+           decodeJournalRecord(out + records * kJournalRecordSize, kJournalRecordSize, record)) {
+      records++;
+    }
+    cursor.offset += records * kJournalRecordSize;
+    bool torn = records * kJournalRecordSize < length;
+    if (records == 0 && cursor.segment == lastSegment && !torn) {
+      break;  // caught up with the writer
+    }
+    if (torn || records == 0) {
+      cursor.segment++;
+      cursor.offset = 0;
+    }
+  }
+  xSemaphoreGive(fsLock);
+  return records;
+}
+
+void JournalStore::segmentPath(uint32_t number, char* out, size_t outSize) {
+  snprintf(out, outSize, "%s/%08lu", kJournalDir, (unsigned long)number);
+}
+
+// Session of the newest valid record on flash.
+bool JournalStore::findLastSession(uint16_t& lastSession) {
+  char path[24];
+  uint8_t buffer[16 * kJournalRecordSize];
+  for (uint32_t number = lastSegment - 1; number >= firstSegment && number > 0; number--) {
+    segmentPath(number, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) {
+      continue;
+    }
+    bool found = false;
+    size_t length;
+    JournalRecord record;
+    while ((length = file.read(buffer, sizeof(buffer))) >= kJournalRecordSize) {
+      size_t offset = 0;
+      while (offset + kJournalRecordSize <= length &&
+             decodeJournalRecord(buffer + offset, kJournalRecordSize, record)) {
+        lastSession = record.session;
+        found = true;
+        offset += kJournalRecordSize;
+      }
+      if (offset < length) {
+        break;  // torn tail
+      }
+    }
+    file.close();
+    if (found) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// fsLock held. Starts lastSegment and drops the oldest segments beyond
+// the budget.
+void JournalStore::openSegment() {
+  char path[24];
+  while (lastSegment - firstSegment + 1 > kMaxSegments) {
+    segmentPath(firstSegment, path, sizeof(path));
+    LittleFS.remove(path);
+    firstSegment++;
+  }
+  segmentPath(lastSegment, path, sizeof(path));
+  segment = LittleFS.open(path, FILE_APPEND);
+  if (!segment) {
+    LOG_WARN("Journal: cannot open %s", path);
+  }
+}
+
+void JournalStore::writePending() {
+  uint8_t batch[16 * kJournalRecordSize];
+  char slot[RecordQueue::kSlotSize];
+  xSemaphoreTake(fsLock, portMAX_DELAY);
+  size_t wrote = 0;
+  for (;;) {
+    size_t count = 0;
+    while (count < sizeof(batch) / kJournalRecordSize &&
+           pending.pop(slot, sizeof(slot)) == kJournalRecordSize) {
+      memcpy(batch + count * kJournalRecordSize, slot, kJournalRecordSize);
+      count++;
+    }
+    if (count == 0) {
+      break;
+    }
+    if (!segment) {
+      openSegment();
+    }
+    if (segment) {
+      segment.write(batch, count * kJournalRecordSize);
+      wrote += count;
+    }
+  }
+  if (wrote > 0 && segment) {
+    segment.flush();  // commits the batch: all of it survives a reset or none
+    if (segment.size() >= kSegmentBytes) {
+      segment.close();
+      lastSegment++;
+    }
+  }
+  xSemaphoreGive(fsLock);
+}
+
+void JournalStore::writerTaskEntry(void* arg) {
+  JournalStore* journal = static_cast<JournalStore*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    vTaskDelay(kBatchTicks);
+    journal->writePending();
+  }
+}
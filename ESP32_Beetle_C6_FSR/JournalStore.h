@@ -0,0 +1,74 @@
+// JournalStore.h
+#ifndef JOURNAL_STORE_H
+#define JOURNAL_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "CommandQueue.h"
+#include "PunchJournal.h"
+
+// Append-only punch journal on LittleFS. The sampling task hands records
+// to a queue; a low-priority writer task appends them in batches to
+// numbered segment files (/pj/00000001, ...) and syncs each batch, so a
+// reset loses at most the batch being collected. Full segments are closed
+// and the oldest deleted once the budget is used; LittleFS spreads the
+// erases over the partition.
+//
+// Reads (the bulk download) walk the segments with a cursor while the
+// writer keeps appending; both sides hold fsLock only per file operation.
+class JournalStore {
+public:
+  static const size_t kSegmentBytes = 16 * 1024;  // ~800 punches
+  static const uint32_t kMaxSegments = 32;        // 512 KB of flash
+
+  // Position of the next record to read; start at first().
+  struct Cursor {
+    uint32_t segment;
+    uint32_t offset;
+  };
+
+  JournalStore();
+
+  // Mounts LittleFS (formatting an unreadable partition) and picks up the
+  // newest segment and session. false when there is no usable flash.
+  bool begin();
+  void startWriterTask(UBaseType_t priority);
+  bool isReady();
+
+  // Sampling task: queues one punch frame, never touches flash. false
+  // when the journal is not running or the queue is full.
+  bool append(uint8_t round, const uint8_t* frame);
+
+  // Session of the records appended since boot.
+  uint16_t getSession();
+  uint32_t getDroppedRecords();
+  uint32_t getSegmentCount();
+
+  // Copies up to maxRecords valid records from the cursor on into out and
+  // advances the cursor; 0 once everything written so far has been read.
+  Cursor first();
+  size_t read(Cursor& cursor, uint8_t* out, size_t maxRecords);
+
+private:
+  // Encoded records; a slot keeps one byte for CommandQueue's terminator
+  typedef CommandQueue<64, kJournalRecordSize + 4> RecordQueue;
+
+  RecordQueue pending;
+  SemaphoreHandle_t fsLock;
+  TaskHandle_t writerTask;
+  File segment;            // open for append, writer task only
+  uint32_t firstSegment;   // oldest segment on flash
+  uint32_t lastSegment;    // segment being appended to
+  uint16_t session;
+  bool ready;
+
+  void segmentPath(uint32_t number, char* out, size_t outSize);
+  bool findLastSession(uint16_t& lastSession);
+  void openSegment();
+  void writePending();
+  static void writerTaskEntry(void* arg);
+};
+
+#endif  // JOURNAL_STORE_H
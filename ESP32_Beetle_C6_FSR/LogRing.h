@@ -0,0 +1,98 @@
+// LogRing.h
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// Multi-producer / single-consumer ring of formatted log lines. Any task
+// (main loop, BLE callbacks, sampler) formats straight into a reserved
+// slot; one low-priority drain task writes the lines out. Producers never
+// block or allocate: when every slot is taken the line is dropped and
+// counted, and long lines are cut to the slot size.
+template <size_t Slots, size_t LineSize>
+class LogRing {
+  static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+  LogRing()
+    : head(0), tail(0), droppedLines(0) {
+    for (size_t i = 0; i < Slots; i++) {
+      ready[i].store(false, std::memory_order_relaxed);
+    }
+  }
+
+  // Producer side, any task. Returns false if the line was dropped.
+  bool vprintf(const char* prefix, const char* format, va_list args) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    do {
+      if (h - tail.load(std::memory_order_acquire) >= Slots) {
+        droppedLines.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    } while (!head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    size_t slot = h & (Slots - 1);
+    size_t length = 0;
+    if (prefix != nullptr) {
+      length = strlen(prefix);
+      if (length >= LineSize) {
+        length = LineSize - 1;
+      }
+      memcpy(lines[slot], prefix, length);
+    }
+    int written = vsnprintf(lines[slot] + length, LineSize - length, format, args);
+    if (written > 0) {
+      length += (size_t)written < LineSize - length ? written : LineSize - length - 1;
+    }
+    lengths[slot] = length;
+    ready[slot].store(true, std::memory_order_release);
+    return true;
+  }
+
+  bool printf(const char* prefix, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    bool stored = vprintf(prefix, format, args);
+    va_end(args);
+    return stored;
+  }
+
+  // Consumer side. Copies the oldest finished line (without newline) into
+  // out and returns its length; 0 when nothing is ready. A line still being
+  // formatted holds back the ones after it.
+  size_t pop(char* out, size_t outSize) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) {
+      return 0;
+    }
+    size_t slot = t & (Slots - 1);
+    if (!ready[slot].load(std::memory_order_acquire)) {
+      return 0;
+    }
+    size_t length = lengths[slot] < outSize ? lengths[slot] : outSize - 1;
+    memcpy(out, lines[slot], length);
+    out[length] = '\0';
+    ready[slot].store(false, std::memory_order_relaxed);
+    tail.store(t + 1, std::memory_order_release);
+    return length;
+  }
+
+  uint32_t getDroppedLines() const {
+    return droppedLines.load(std::memory_order_relaxed);
+  }
+
+private:
+  char lines[Slots][LineSize];
+  size_t lengths[Slots];
+  std::atomic<bool> ready[Slots];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> droppedLines;
+};
+
+#endif  // LOG_RING_H
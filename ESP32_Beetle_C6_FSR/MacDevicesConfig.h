@@ -1,25 +1,47 @@
 #ifndef MAC_DEVICES_CONFIG_H
 #define MAC_DEVICES_CONFIG_H
 
-#include <Arduino.h>
-
-// Array of MAC addresses for BlueBoxer
-static const String BLUEBOXER_MACS[] = {
-  "f0:f5:bd:2c:10:72",
-  "f0:f5:bd:2c:1a:32",
-  "f0:f5:bd:2c:0b:ee",
-  "f0:f5:bd:2c:16:3a",
-  "54:32:04:3f:e8:8e"
+#include <stdint.h>
+#include <stddef.h>
+#include "PunchFrame.h"
 
+// Factory role of every known sensor, keyed by its Bluetooth MAC packed
+// into the low 48 bits (f0:f5:bd:2c:10:72 -> 0xF0F5BD2C1072). Only used
+// the first time a sensor boots without a role in NVS (see DeviceRole).
+struct MacDeviceRole {
+  uint64_t mac;
+  uint8_t device;  // PunchDevice
 };
-static const int NUM_BLUEBOXER_MACS = sizeof(BLUEBOXER_MACS) / sizeof(BLUEBOXER_MACS[0]);
 
-// Array of MAC addresses for RedBoxer
-static const String REDBOXER_MACS[] = {
-  "f0:f5:bd:2c:15:1a",
-  "f0:f5:bd:2c:11:e6",
-  "54:32:04:3f:da:ee"
+static const MacDeviceRole KNOWN_DEVICE_MACS[] = {
+  { 0xF0F5BD2C1072ULL, PunchDeviceBlueBoxer },
+  { 0xF0F5BD2C1A32ULL, PunchDeviceBlueBoxer },
+  { 0xF0F5BD2C0BEEULL, PunchDeviceBlueBoxer },
+  { 0xF0F5BD2C163AULL, PunchDeviceBlueBoxer },
+  { 0x5432043FE88EULL, PunchDeviceBlueBoxer },
+
+  { 0xF0F5BD2C151AULL, PunchDeviceRedBoxer },
+  { 0xF0F5BD2C11E6ULL, PunchDeviceRedBoxer },
+  { 0x5432043FDAEEULL, PunchDeviceRedBoxer },
 };
-static const int NUM_REDBOXER_MACS = sizeof(REDBOXER_MACS) / sizeof(REDBOXER_MACS[0]);
+static const size_t NUM_KNOWN_DEVICE_MACS = sizeof(KNOWN_DEVICE_MACS) / sizeof(KNOWN_DEVICE_MACS[0]);
+
+inline uint64_t packMac(const uint8_t* mac) {
+  uint64_t packed = 0;
+  for (int i = 0; i < 6; i++) {
+    packed = (packed << 8) | mac[i];
+  }
+  return packed;
+}
+
+// PunchDeviceUnknown for a MAC not in the table.
+inline uint8_t deviceForMac(uint64_t mac) {
+  for (size_t i = 0; i < NUM_KNOWN_DEVICE_MACS; i++) {
+    if (KNOWN_DEVICE_MACS[i].mac == mac) {
+      return KNOWN_DEVICE_MACS[i].device;
+    }
+  }
+  return PunchDeviceUnknown;
+}
 
 #endif
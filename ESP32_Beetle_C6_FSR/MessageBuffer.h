@@ -0,0 +1,90 @@
+// MessageBuffer.h
+#ifndef MESSAGE_BUFFER_H
+#define MESSAGE_BUFFER_H
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Fixed-capacity text buffer for building outbound messages and log lines
+// on the stack instead of with String concatenation. Never allocates;
+// output that does not fit is cut off and flagged.
+template <size_t Capacity>
+class MessageBuffer {
+public:
+  MessageBuffer()
+    : length(0), truncated(false) {
+    text[0] = '\0';
+  }
+
+  MessageBuffer& append(const char* value) {
+    size_t room = Capacity - 1 - length;
+    size_t size = strlen(value);
+    if (size > room) {
+      size = room;
+      truncated = true;
+    }
+    memcpy(text + length, value, size);
+    length += size;
+    text[length] = '\0';
+    return *this;
+  }
+
+  MessageBuffer& appendf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(text + length, Capacity - length, format, args);
+    va_end(args);
+    if (written < 0) {
+      text[length] = '\0';
+      truncated = true;
+    } else if ((size_t)written >= Capacity - length) {
+      length = Capacity - 1;
+      truncated = true;
+    } else {
+      length += written;
+    }
+    return *this;
+  }
+
+  // Direct access for formatters that write into a char buffer themselves
+  // (FSRPunchDetector::getPunchDetails); call setLength() afterwards.
+  char* data() {
+    return text;
+  }
+
+  void setLength(size_t size) {
+    length = size < Capacity ? size : Capacity - 1;
+    text[length] = '\0';
+  }
+
+  const char* c_str() const {
+    return text;
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+  static size_t capacity() {
+    return Capacity;
+  }
+
+  bool isTruncated() const {
+    return truncated;
+  }
+
+  void clear() {
+    length = 0;
+    truncated = false;
+    text[0] = '\0';
+  }
+
+private:
+  char text[Capacity];
+  size_t length;
+  bool truncated;
+};
+
+#endif  // MESSAGE_BUFFER_H
@@ -0,0 +1,95 @@
+// NotifyCoalescer.h
+#ifndef NOTIFY_COALESCER_H
+#define NOTIFY_COALESCER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Packs fixed-size binary records (PunchFrame) back to back into one
+// notification payload. A batch goes out when the next record would not
+// fit, or once its oldest record has waited maxDelayUs. The payload limit
+// follows the negotiated ATT MTU (MTU - 3); until the client exchanges MTU
+// only the default 20 bytes are safe.
+class NotifyCoalescer {
+public:
+  static const size_t kMaxPayload = 244;     // MTU 247 - 3 bytes ATT header
+  static const size_t kDefaultPayload = 20;  // MTU 23 before the exchange
+  static const uint32_t kDefaultDelayUs = 5000;
+
+  NotifyCoalescer()
+    : length(0), firstUs(0), maxDelayUs(kDefaultDelayUs), payloadLimit(kDefaultPayload) {}
+
+  // Returns false when the record does not fit the current batch; flush
+  // and append again.
+  bool append(const uint8_t* record, size_t size, uint64_t nowUs) {
+    if (length + size > payloadLimit) {
+      return false;
+    }
+    if (length == 0) {
+      firstUs = nowUs;
+    }
+    memcpy(buffer + length, record, size);
+    length += size;
+    return true;
+  }
+
+  bool isDue(uint64_t nowUs) const {
+    return length > 0 && (length == payloadLimit || nowUs - firstUs >= maxDelayUs);
+  }
+
+  // Time left before the batch is due; 0 when due now. Only meaningful
+  // while the batch is not empty.
+  uint32_t dueInUs(uint64_t nowUs) const {
+    if (length == payloadLimit || nowUs - firstUs >= maxDelayUs) {
+      return 0;
+    }
+    return (uint32_t)(firstUs + maxDelayUs - nowUs);
+  }
+
+  // Time passed to append() for the oldest record of the batch.
+  uint64_t getFirstUs() const {
+    return firstUs;
+  }
+
+  const uint8_t* data() const {
+    return buffer;
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+  bool empty() const {
+    return length == 0;
+  }
+
+  void clear() {
+    length = 0;
+  }
+
+  void setMaxDelayUs(uint32_t delayUs) {
+    maxDelayUs = delayUs;
+  }
+
+  uint32_t getMaxDelayUs() const {
+    return maxDelayUs;
+  }
+
+  void setPayloadLimit(size_t limit) {
+    payloadLimit = limit < kMaxPayload ? limit : kMaxPayload;
+  }
+
+  size_t getPayloadLimit() const {
+    return payloadLimit;
+  }
+
+private:
+  uint8_t buffer[kMaxPayload];
+  size_t length;
+  uint64_t firstUs;
+  uint32_t maxDelayUs;
+  size_t payloadLimit;
+};
+
+#endif  // NOTIFY_COALESCER_H
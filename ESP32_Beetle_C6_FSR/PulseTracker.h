@@ -0,0 +1,72 @@
+// PulseTracker.h
+#ifndef PULSE_TRACKER_H
+#define PULSE_TRACKER_H
+
+#include <stdint.h>
+
+// Shape of one hit on one pad (or of a whole punch).
+struct PulseFeatures {
+  uint16_t peakMv;
+  uint32_t timeToPeakUs;  // onset to peak
+  uint32_t widthUs;       // onset to release
+  uint32_t impulse;       // area under the curve, mV*ms
+};
+
+// Streaming measurement of a single pulse, fed one sample at a time from
+// trigger to release. Constant memory, no allocation, integer math only.
+class PulseTracker {
+public:
+  PulseTracker()
+    : onsetUs(0), peakUs(0), lastUs(0), areaMvUs(0), peakMv(0), lastMv(0), active(false) {}
+
+  void start(uint16_t mv, uint64_t timeUs) {
+    onsetUs = peakUs = lastUs = timeUs;
+    peakMv = lastMv = mv;
+    areaMvUs = 0;
+    active = true;
+  }
+
+  void add(uint16_t mv, uint64_t timeUs) {
+    // Trapezoidal integration between consecutive samples
+    areaMvUs += (uint64_t)(lastMv + mv) * (timeUs - lastUs) / 2;
+    if (mv > peakMv) {
+      peakMv = mv;
+      peakUs = timeUs;
+    }
+    lastMv = mv;
+    lastUs = timeUs;
+  }
+
+  PulseFeatures finish() {
+    active = false;
+    PulseFeatures features;
+    features.peakMv = peakMv;
+    features.timeToPeakUs = (uint32_t)(peakUs - onsetUs);
+    features.widthUs = (uint32_t)(lastUs - onsetUs);
+    features.impulse = (uint32_t)(areaMvUs / 1000);
+    return features;
+  }
+
+  void cancel() {
+    active = false;
+  }
+
+  bool isActive() const {
+    return active;
+  }
+
+  uint64_t getOnsetUs() const {
+    return onsetUs;
+  }
+
+private:
+  uint64_t onsetUs;
+  uint64_t peakUs;
+  uint64_t lastUs;
+  uint64_t areaMvUs;
+  uint16_t peakMv;
+  uint16_t lastMv;
+  bool active;
+};
+
+#endif  // PULSE_TRACKER_H
@@ -0,0 +1,113 @@
+// PunchFrame.h
+#ifndef PUNCH_FRAME_H
+#define PUNCH_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Compact binary punch report sent on the TX characteristic instead of the
+// "Punch Count: ... | Sensor millivolts: ..." text once the app asks for it
+// with {"PunchFormat":"Binary"}. Fixed layout, little-endian:
+//
+//   0     marker   0xB0 | version (0xB2 for version 2)
+//   1     device   PunchDevice
+//   2-3   seq      frame sequence number, wraps
+//   4-5   count    punch count in the round
+//   6-9   time     round time of the punch, microseconds
+//   10-11 peak     strongest pad peak, mV
+//   12    zone     bit n set: pad n was hit
+//   13    flags    bit 0: every pad hit has a force curve
+//   14-15 force    summed force of the calibrated pads hit, 0.1 N
+//
+// Version 1 was the first 14 bytes with flags 0 and no force.
+// The marker is never the first byte of a UTF-8 string, so the app can tell
+// binary frames from JSON/text notifications by the first byte alone.
+static const uint8_t kPunchFrameMarker = 0xB0;
+static const uint8_t kPunchFrameVersion = 2;
+static const size_t kPunchFrameSize = 16;
+static const uint8_t kPunchFlagForceCalibrated = 0x01;
+
+enum PunchDevice : uint8_t {
+  PunchDeviceUnknown = 0,
+  PunchDeviceBlueBoxer = 1,
+  PunchDeviceRedBoxer = 2,
+};
+
+struct PunchFrame {
+  uint8_t device;
+  uint16_t seq;
+  uint16_t punchCount;
+  uint32_t timeUs;
+  uint16_t peakMv;
+  uint8_t zoneMask;
+  uint8_t flags;
+  uint16_t forceDn;
+};
+
+inline uint8_t punchDeviceFromName(const char* name) {
+  if (name == nullptr) {
+    return PunchDeviceUnknown;
+  }
+  if (strcmp(name, "BlueBoxer") == 0) {
+    return PunchDeviceBlueBoxer;
+  }
+  if (strcmp(name, "RedBoxer") == 0) {
+    return PunchDeviceRedBoxer;
+  }
+  return PunchDeviceUnknown;
+}
+
+inline const char* punchDeviceName(uint8_t device) {
+  switch (device) {
+    case PunchDeviceBlueBoxer:
+      return "BlueBoxer";
+    case PunchDeviceRedBoxer:
+      return "RedBoxer";
+    default:
+      return "UnknownDevice";
+  }
+}
+
+// Returns the number of bytes written, 0 when out is too small.
+inline size_t encodePunchFrame(const PunchFrame& frame, uint8_t* out, size_t outSize) {
+  if (outSize < kPunchFrameSize) {
+    return 0;
+  }
+  out[0] = kPunchFrameMarker | kPunchFrameVersion;
+  out[1] = frame.device;
+  out[2] = (uint8_t)frame.seq;
+  out[3] = (uint8_t)(frame.seq >> 8);
+  out[4] = (uint8_t)frame.punchCount;
+  out[5] = (uint8_t)(frame.punchCount >> 8);
+  out[6] = (uint8_t)frame.timeUs;
+  out[7] = (uint8_t)(frame.timeUs >> 8);
+  out[8] = (uint8_t)(frame.timeUs >> 16);
+  out[9] = (uint8_t)(frame.timeUs >> 24);
+  out[10] = (uint8_t)frame.peakMv;
+  out[11] = (uint8_t)(frame.peakMv >> 8);
+  out[12] = frame.zoneMask;
+  out[13] = frame.flags;
+  out[14] = (uint8_t)frame.forceDn;
+  out[15] = (uint8_t)(frame.forceDn >> 8);
+  return kPunchFrameSize;
+}
+
+// Returns false for anything that is not a version 2 punch frame.
+inline bool decodePunchFrame(const uint8_t* data, size_t length, PunchFrame& frame) {
+  if (length < kPunchFrameSize || data[0] != (kPunchFrameMarker | kPunchFrameVersion)) {
+    return false;
+  }
+  frame.device = data[1];
+  frame.seq = (uint16_t)(data[2] | (data[3] << 8));
+  frame.punchCount = (uint16_t)(data[4] | (data[5] << 8));
+  frame.timeUs = (uint32_t)data[6] | ((uint32_t)data[7] << 8) |
+                 ((uint32_t)data[8] << 16) | ((uint32_t)data[9] << 24);
+  frame.peakMv = (uint16_t)(data[10] | (data[11] << 8));
+  frame.zoneMask = data[12];
+  frame.flags = data[13];
+  frame.forceDn = (uint16_t)(data[14] | (data[15] << 8));
+  return true;
+}
+
+#endif  // PUNCH_FRAME_H
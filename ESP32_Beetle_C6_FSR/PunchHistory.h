@@ -0,0 +1,79 @@
+// PunchHistory.h
+#ifndef PUNCH_HISTORY_H
+#define PUNCH_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "PunchFrame.h"
+
+// The last kCapacity punch frames sent, indexed by their sequence number,
+// so the app can ask for the ones it missed ({"Resend":{"FromSeq":N}})
+// after a dropped notification or a reconnect. Sequence numbers start at
+// 0 on boot and wrap at 65536; the ring keeps frames as sent.
+class PunchHistory {
+public:
+  static const size_t kCapacity = 256;  // ~3.5 KB, several rounds of punches
+
+  PunchHistory()
+    : nextSeq(0), count(0) {}
+
+  uint16_t getNextSeq() const {
+    return nextSeq;
+  }
+
+  // Stores a frame encoded with getNextSeq() and advances the sequence.
+  void store(const uint8_t* frame) {
+    memcpy(frames[nextSeq % kCapacity], frame, kPunchFrameSize);
+    nextSeq++;
+    if (count < kCapacity) {
+      count++;
+    }
+  }
+
+  // Oldest sequence number still held.
+  uint16_t getOldestSeq() const {
+    return (uint16_t)(nextSeq - count);
+  }
+
+  // Number of frames from fromSeq up to the newest; 0 when fromSeq is not
+  // behind the newest frame.
+  size_t pendingSince(uint16_t fromSeq) const {
+    uint16_t distance = (uint16_t)(nextSeq - fromSeq);
+    return distance <= 0x8000 ? distance : 0;
+  }
+
+  // First sequence number a resend from fromSeq can deliver: fromSeq
+  // itself, the oldest frame held when older ones were overwritten (lost
+  // counts those), or getNextSeq() when fromSeq is not behind the newest
+  // frame (e.g. the app remembers a session from before a reboot).
+  uint16_t resendStart(uint16_t fromSeq, size_t& lost) const {
+    lost = 0;
+    size_t pending = pendingSince(fromSeq);
+    if (pending == 0) {
+      return nextSeq;
+    }
+    if (pending > count) {
+      lost = pending - count;
+      return getOldestSeq();
+    }
+    return fromSeq;
+  }
+
+  // Frame with the given sequence number, nullptr when already overwritten
+  // or not sent yet.
+  const uint8_t* find(uint16_t seq) const {
+    uint16_t age = (uint16_t)(nextSeq - seq);
+    if (age == 0 || age > count) {
+      return nullptr;
+    }
+    return frames[seq % kCapacity];
+  }
+
+private:
+  uint8_t frames[kCapacity][kPunchFrameSize];
+  uint16_t nextSeq;
+  size_t count;
+};
+
+#endif  // PUNCH_HISTORY_H
@@ -0,0 +1,78 @@
+// PunchJournal.h
+#ifndef PUNCH_JOURNAL_H
+#define PUNCH_JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "PunchFrame.h"
+
+// Record format of the punch journal kept in flash (JournalStore), so
+// punches survive a phone that walks away or an app that gets killed.
+// Every punch frame is appended as one fixed-size record, little-endian:
+//
+//   0     marker   0x5B (0x5A held a 14-byte version 1 frame)
+//   1     round    round of the program the punch fell in
+//   2-3   session  boot number; the frame seq restarts with it
+//   4-19  frame    the PunchFrame as sent
+//   20-21 crc      CRC-16/CCITT-FALSE over bytes 0-19
+//
+// A record torn by a reset fails the CRC and ends its segment on replay.
+// Segments in the old format are dropped when the journal starts.
+//
+// The bulk download ({"JournalSync":...}) sends the records unchanged,
+// packed behind one chunk marker per notification. Like the punch frame
+// marker it is never the first byte of a UTF-8 string.
+static const uint8_t kJournalRecordMarker = 0x5B;
+static const size_t kJournalRecordSize = 4 + kPunchFrameSize + 2;
+static const uint8_t kJournalChunkMarker = 0xB8;
+
+struct JournalRecord {
+  uint8_t round;
+  uint16_t session;
+  uint8_t frame[kPunchFrameSize];
+};
+
+inline uint16_t journalCrc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Returns the number of bytes written, 0 when out is too small.
+inline size_t encodeJournalRecord(const JournalRecord& record, uint8_t* out, size_t outSize) {
+  if (outSize < kJournalRecordSize) {
+    return 0;
+  }
+  out[0] = kJournalRecordMarker;
+  out[1] = record.round;
+  out[2] = (uint8_t)record.session;
+  out[3] = (uint8_t)(record.session >> 8);
+  memcpy(out + 4, record.frame, kPunchFrameSize);
+  uint16_t crc = journalCrc16(out, kJournalRecordSize - 2);
+  out[kJournalRecordSize - 2] = (uint8_t)crc;
+  out[kJournalRecordSize - 1] = (uint8_t)(crc >> 8);
+  return kJournalRecordSize;
+}
+
+// Returns false for a short, torn or foreign record.
+inline bool decodeJournalRecord(const uint8_t* data, size_t length, JournalRecord& record) {
+  if (length < kJournalRecordSize || data[0] != kJournalRecordMarker) {
+    return false;
+  }
+  uint16_t crc = (uint16_t)(data[kJournalRecordSize - 2] | (data[kJournalRecordSize - 1] << 8));
+  if (crc != journalCrc16(data, kJournalRecordSize - 2)) {
+    return false;
+  }
+  record.round = data[1];
+  record.session = (uint16_t)(data[2] | (data[3] << 8));
+  memcpy(record.frame, data + 4, kPunchFrameSize);
+  return true;
+}
+
+#endif  // PUNCH_JOURNAL_H
@@ -0,0 +1,133 @@
+// RoundController.cpp
+#include "RoundController.h"
+
+RoundController::RoundController(TimeHandler& timer, long roundTimeMs, long breakTimeMs)
+  : timeHandler(timer),
+    roundTime(roundTimeMs),
+    breakTime(breakTimeMs),
+    rounds(1),
+    currentRound(0),
+    roundActive(false),
+    inBreak(false),
+    isPaused(false) {}
+
+RoundEvent RoundController::handleCommand(int command) {
+  switch (command) {
+    case RoundCommandStart:
+      timeHandler.reset();
+      timeHandler.start();
+      currentRound = 1;
+      roundActive = true;
+      inBreak = false;
+      isPaused = false;
+      return RoundEventStarted;
+    case RoundCommandPause:
+      timeHandler.pause();
+      isPaused = true;
+      return RoundEventPaused;
+    case RoundCommandResume:
+      timeHandler.resume();
+      isPaused = false;
+      return RoundEventResumed;
+    case RoundCommandReset:  // restarts the current round
+      timeHandler.reset();
+      timeHandler.start();
+      if (currentRound == 0) {
+        currentRound = 1;
+      }
+      roundActive = true;
+      inBreak = false;
+      isPaused = false;
+      return RoundEventReset;
+    case RoundCommandEnd:
+      roundActive = false;
+      inBreak = false;
+      timeHandler.reset();
+      return RoundEventEnded;
+    default:
+      return RoundEventUnknownCommand;
+  }
+}
+
+RoundEvent RoundController::update() {
+  if (isPaused || (!roundActive && !inBreak)) {
+    return RoundEventNone;
+  }
+  uint64_t elapsed = timeHandler.getElapsedMicros();
+  if (roundActive) {
+    uint64_t length = (uint64_t)roundTime * 1000ULL;
+    if (elapsed < length) {
+      return RoundEventNone;
+    }
+    roundActive = false;
+    if (currentRound < rounds) {
+      inBreak = true;
+      timeHandler.restartFrom(elapsed - length);
+      return RoundEventBreakStarted;
+    }
+    timeHandler.reset();
+    return RoundEventCompleted;
+  }
+  uint64_t length = (uint64_t)breakTime * 1000ULL;
+  if (elapsed < length) {
+    return RoundEventNone;
+  }
+  inBreak = false;
+  roundActive = true;
+  currentRound++;
+  timeHandler.restartFrom(elapsed - length);
+  return RoundEventRoundStarted;
+}
+
+bool RoundController::isActive() {
+  return roundActive;
+}
+
+bool RoundController::isInBreak() {
+  return inBreak;
+}
+
+bool RoundController::isRoundPaused() {
+  return isPaused;
+}
+
+bool RoundController::isDetecting() {
+  return roundActive && !isPaused;
+}
+
+uint64_t RoundController::getMicrosToBoundary() {
+  if (isPaused || (!roundActive && !inBreak)) {
+    return UINT64_MAX;
+  }
+  uint64_t length = (uint64_t)(roundActive ? roundTime : breakTime) * 1000ULL;
+  uint64_t elapsed = timeHandler.getElapsedMicros();
+  return elapsed < length ? length - elapsed : 0;
+}
+
+int RoundController::getCurrentRound() {
+  return currentRound;
+}
+
+void RoundController::setRounds(int count) {
+  rounds = count < 1 ? 1 : count;
+}
+
+int RoundController::getRounds() {
+  return rounds;
+}
+
+void RoundController::setRoundTime(long ms) {
+  roundTime = ms;
+}
+
+long RoundController::getRoundTime() {
+  return roundTime;
+}
+
+void RoundController::setBreakTime(long ms) {
+  breakTime = ms;
+}
+
+long RoundController::getBreakTime() {
+  return breakTime;
+}
@@ -0,0 +1,66 @@
+// RoundController.h
+#ifndef ROUND_CONTROLLER_H
+#define ROUND_CONTROLLER_H
+
+#include "TimeHandler.h"
+
+// RoundStatusCommand values sent by the app
+enum RoundCommand {
+  RoundCommandStart = 1,
+  RoundCommandPause = 2,
+  RoundCommandResume = 3,
+  RoundCommandReset = 4,
+  RoundCommandEnd = 5
+};
+
+enum RoundEvent {
+  RoundEventNone,
+  RoundEventStarted,
+  RoundEventPaused,
+  RoundEventResumed,
+  RoundEventReset,
+  RoundEventEnded,
+  RoundEventCompleted,       // last round of the program is over
+  RoundEventBreakStarted,    // a round is over and more follow
+  RoundEventRoundStarted,    // a break is over, the next round runs
+  RoundEventUnknownCommand
+};
+
+// Round state machine: start/pause/resume/reset/end and the round timeout.
+// Start runs a program of `rounds` rounds with breaks in between, timed
+// here on the microsecond clock rather than by the app. Knows nothing
+// about BLE or JSON; BoxingApp turns its events into messages.
+class RoundController {
+private:
+  TimeHandler& timeHandler;
+  long roundTime;
+  long breakTime;
+  int rounds;
+  int currentRound;
+  bool roundActive;
+  bool inBreak;
+  bool isPaused;
+
+public:
+  RoundController(TimeHandler& timer, long roundTimeMs, long breakTimeMs);
+
+  RoundEvent handleCommand(int command);
+  RoundEvent update();  // at most one boundary per call
+
+  bool isActive();
+  bool isInBreak();
+  bool isRoundPaused();
+  bool isDetecting();  // active and not paused
+  uint64_t getMicrosToBoundary();  // until the running round or break ends; UINT64_MAX if none
+
+  int getCurrentRound();
+  void setRounds(int count);  // clamped to at least 1
+  int getRounds();
+
+  void setRoundTime(long ms);
+  long getRoundTime();
+  void setBreakTime(long ms);
+  long getBreakTime();
+};
+
+#endif  // ROUND_CONTROLLER_H
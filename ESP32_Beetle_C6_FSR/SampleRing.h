@@ -0,0 +1,84 @@
+// SampleRing.h
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Single-producer / single-consumer ring of multi-channel ADC frames and
+// their capture times. Each channel has its own lane so a consumer can
+// walk one pad's samples contiguously. The producer (sampling task) never
+// blocks: when the ring is full the frame is dropped and counted.
+template <uint8_t Channels, size_t Capacity>
+class SampleRing {
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+  SampleRing()
+    : head(0), tail(0), droppedFrames(0) {}
+
+  // Producer side. Returns false if the frame was dropped.
+  bool push(const uint16_t* frame, uint64_t timeUs) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= Capacity) {
+      droppedFrames.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    size_t slot = h & (Capacity - 1);
+    for (uint8_t ch = 0; ch < Channels; ch++) {
+      lanes[ch][slot] = frame[ch];
+    }
+    times[slot] = timeUs;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Copies up to maxFrames frames into out[frame][channel]
+  // and their capture times into timesUs; returns how many were copied.
+  size_t pop(uint16_t (*out)[Channels], uint64_t* timesUs, size_t maxFrames) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    size_t count = h - t;
+    if (count > maxFrames) count = maxFrames;
+    for (size_t i = 0; i < count; i++) {
+      size_t slot = (t + i) & (Capacity - 1);
+      for (uint8_t ch = 0; ch < Channels; ch++) {
+        out[i][ch] = lanes[ch][slot];
+      }
+      timesUs[i] = times[slot];
+    }
+    tail.store(t + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side. Drops everything queued so far.
+  void discard() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  size_t available() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+  }
+
+  uint32_t dropped() const {
+    return droppedFrames.load(std::memory_order_relaxed);
+  }
+
+  // Only safe while the producer is stopped.
+  void clear() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    droppedFrames.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  uint16_t lanes[Channels][Capacity];
+  uint64_t times[Capacity];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> droppedFrames;
+};
+
+#endif  // SAMPLE_RING_H
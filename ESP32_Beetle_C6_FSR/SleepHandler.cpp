@@ -0,0 +1,43 @@
+// SleepHandler.cpp
+#include "SleepHandler.h"
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+
+SleepHandler::SleepHandler(const std::initializer_list<int>& pinList)
+  : pins(pinList), wakeUs(0) {}
+
+SleepWake SleepHandler::sleep(uint64_t timeoutUs) {
+  for (int pin : pins) {
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT);
+    if (gpio_get_level((gpio_num_t)pin)) {
+      wakeUs = esp_timer_get_time();
+      return SleepWakeImpact;  // a level wakeup would fire at once anyway
+    }
+    gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_HIGH_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(timeoutUs);
+
+  esp_light_sleep_start();
+  wakeUs = esp_timer_get_time();  // esp_timer keeps counting through light sleep
+
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  for (int pin : pins) {
+    gpio_wakeup_disable((gpio_num_t)pin);
+  }
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+
+  switch (cause) {
+    case ESP_SLEEP_WAKEUP_GPIO:
+      return SleepWakeImpact;
+    case ESP_SLEEP_WAKEUP_TIMER:
+      return SleepWakeTimer;
+    default:
+      return SleepWakeOther;
+  }
+}
+
+uint64_t SleepHandler::getWakeUs() {
+  return wakeUs;
+}
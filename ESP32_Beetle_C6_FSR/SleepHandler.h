@@ -0,0 +1,34 @@
+// SleepHandler.h
+#ifndef SLEEP_HANDLER_H
+#define SLEEP_HANDLER_H
+
+#include <Arduino.h>
+#include <vector>
+#include <initializer_list>
+
+enum SleepWake {
+  SleepWakeTimer,
+  SleepWakeImpact,  // a pad went above its digital input level
+  SleepWakeOther
+};
+
+// Light sleep for an idle sensor, woken by a hit on any pad or a timer.
+// The ESP32-C6 LP core cannot sample the ADC, so the pads are watched as
+// plain GPIO level wakeups instead: a hard hit lifts the FSR divider over
+// the pin's input-high level (~0.75 VDD). RAM, tasks and the BLE stack
+// are kept; the caller stops advertising first.
+class SleepHandler {
+public:
+  SleepHandler(const std::initializer_list<int>& pins);
+
+  // Sleeps until a pad is hit or timeoutUs passes. Returns immediately
+  // with SleepWakeImpact if a pad is already high.
+  SleepWake sleep(uint64_t timeoutUs);
+  uint64_t getWakeUs();  // esp_timer time of the last wake
+
+private:
+  std::vector<int> pins;
+  uint64_t wakeUs;
+};
+
+#endif  // SLEEP_HANDLER_H
@@ -0,0 +1,117 @@
+// Telemetry.h
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "MessageBuffer.h"
+
+// Fixed-bucket histogram for on-device health telemetry (latencies, queue
+// depth, free heap). Recording is a few instructions and never allocates.
+// With linearWidth 0 the buckets are powers of two: bucket 0 holds 0,
+// bucket n holds [2^(n-1), 2^n). Otherwise bucket n holds
+// [n * width, (n + 1) * width). The last bucket takes everything above.
+//
+// Not thread-safe: each histogram has one writer, and readers copy it
+// under the lock that writer holds.
+template <size_t Buckets>
+class Histogram {
+  static_assert(Buckets >= 2 && Buckets <= 32, "Buckets must be 2..32");
+
+public:
+  explicit Histogram(uint32_t linearWidth = 0)
+    : width(linearWidth) {
+    reset();
+  }
+
+  void record(uint32_t value) {
+    size_t bucket;
+    if (width == 0) {
+      bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    } else {
+      bucket = value / width;
+    }
+    if (bucket >= Buckets) {
+      bucket = Buckets - 1;
+    }
+    counts[bucket]++;
+    count++;
+    if (value > maxValue) {
+      maxValue = value;
+    }
+  }
+
+  void reset() {
+    for (size_t i = 0; i < Buckets; i++) {
+      counts[i] = 0;
+    }
+    count = 0;
+    maxValue = 0;
+  }
+
+  uint32_t getCount() const {
+    return count;
+  }
+
+  uint32_t getMax() const {
+    return maxValue;
+  }
+
+  uint32_t getBucket(size_t bucket) const {
+    return counts[bucket];
+  }
+
+  // Smallest value that falls into the bucket.
+  uint32_t bucketLow(size_t bucket) const {
+    if (width == 0) {
+      return bucket == 0 ? 0 : (uint32_t)1 << (bucket - 1);
+    }
+    return (uint32_t)bucket * width;
+  }
+
+  // Upper edge of the bucket holding the given per-mille rank, clipped to
+  // the largest value seen; 0 when empty.
+  uint32_t percentile(uint32_t perMille) const {
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = ((uint64_t)count * perMille + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets - 1; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint32_t upper = bucketLow(i + 1) - 1;
+        return upper < maxValue ? upper : maxValue;
+      }
+    }
+    return maxValue;
+  }
+
+  // "N":..,"Max":..,"P50":..,"P99":..,"B":[..] without trailing empty
+  // buckets; the caller adds the braces and a name.
+  template <size_t Capacity>
+  void appendJson(MessageBuffer<Capacity>& out) const {
+    out.appendf("\"N\":%lu,\"Max\":%lu,\"P50\":%lu,\"P99\":%lu,\"B\":[",
+                (unsigned long)count, (unsigned long)maxValue,
+                (unsigned long)percentile(500), (unsigned long)percentile(990));
+    size_t used = Buckets;
+    while (used > 0 && counts[used - 1] == 0) {
+      used--;
+    }
+    for (size_t i = 0; i < used; i++) {
+      out.appendf(i == 0 ? "%lu" : ",%lu", (unsigned long)counts[i]);
+    }
+    out.append("]");
+  }
+
+private:
+  uint32_t width;
+  uint32_t counts[Buckets];
+  uint32_t count;
+  uint32_t maxValue;
+};
+
+// Microsecond latencies: 0 up to >= 262 ms in the last bucket.
+typedef Histogram<20> LatencyHistogram;
+
+#endif  // TELEMETRY_H
@@ -1,13 +1,13 @@
 #include "TimeHandler.h"
 
 // Constructor
-TimeHandler::TimeHandler()
-  : startCountTime(0), elapsedTime(0), isRunning(false), pausedTime(0), resumedTime(0) {}
+TimeHandler::TimeHandler(Clock& clockSource)
+  : clock(clockSource), startMicros(0), elapsedMicros(0), isRunning(false), pausedMicros(0), resumedMicros(0) {}
 
 // Start the timer (or resume from where it was paused)
 void TimeHandler::start() {
   if (!isRunning) {
-    startCountTime = millis() - elapsedTime;  // Adjust to resume if paused
+    startMicros = clock.micros64() - elapsedMicros;  // Adjust to resume if paused
     isRunning = true;
   }
 }
@@ -15,8 +15,8 @@ void TimeHandler::start() {
 // Pause the timer
 void TimeHandler::pause() {
   if (isRunning) {
-    elapsedTime = millis() - startCountTime;  // Record the elapsed time
-    pausedTime = elapsedTime / 1000;          // Record paused time in seconds
+    elapsedMicros = clock.micros64() - startMicros;  // Record the elapsed time
+    pausedMicros = elapsedMicros;
     isRunning = false;
   }
 }
@@ -24,50 +24,64 @@ void TimeHandler::pause() {
 // Resume the timer
 void TimeHandler::resume() {
   if (!isRunning) {
-    startCountTime = millis() - elapsedTime;  // Adjust to resume from where paused
-    resumedTime = elapsedTime / 1000;         // Record resumed time in seconds
+    startMicros = clock.micros64() - elapsedMicros;  // Adjust to resume from where paused
+    resumedMicros = elapsedMicros;
     isRunning = true;
   }
 }
 
 // Reset the timer (elapsed time set to 0, timer stopped)
 void TimeHandler::reset() {
-  startCountTime = 0;
-  elapsedTime = 0;
-  pausedTime = 0;
-  resumedTime = 0;
+  startMicros = 0;
+  elapsedMicros = 0;
+  pausedMicros = 0;
+  resumedMicros = 0;
   isRunning = false;
 }
 
 // Restart the timer (reset and start from 0)
 void TimeHandler::restart() {
-  reset();                    // Reset all values
-  startCountTime = millis();  // Start counting from current time
+  reset();                          // Reset all values
+  startMicros = clock.micros64();   // Start counting from current time
   isRunning = true;
 }
 
-// Get elapsed time in milliseconds
-unsigned long TimeHandler::getElapsedMilliseconds() {
+// Restart with time already on the count. Back-to-back periods (round,
+// break, round) carry the overshoot of the previous boundary, so a late
+// check never shifts the boundaries after it.
+void TimeHandler::restartFrom(uint64_t carriedMicros) {
+  reset();
+  startMicros = clock.micros64() - carriedMicros;
+  isRunning = true;
+}
+
+// Get elapsed time in microseconds
+uint64_t TimeHandler::getElapsedMicros() {
   if (isRunning) {
-    return millis() - startCountTime;  // Time since the timer started
+    return clock.micros64() - startMicros;  // Time since the timer started
   } else {
-    return elapsedTime;  // Return paused elapsed time
+    return elapsedMicros;  // Return paused elapsed time
   }
 }
 
+// Get elapsed time in milliseconds
+unsigned long TimeHandler::getElapsedMilliseconds() {
+  return (unsigned long)(getElapsedMicros() / 1000ULL);
+}
+
 // Get elapsed time in seconds
 unsigned long TimeHandler::getElapsedSeconds() {
-  return getElapsedMilliseconds() / 1000;
+  return (unsigned long)(getElapsedMicros() / 1000000ULL);
 }
 
 // Get time when paused
 unsigned long TimeHandler::getPausedTime() {
-  return pausedTime;
+  return (unsigned long)(pausedMicros / 1000000ULL);
 }
 
 // Get time when resumed
 unsigned long TimeHandler::getResumedTime() {
-  return resumedTime;
+  return (unsigned long)(resumedMicros / 1000000ULL);
 }
 
 // Get time since the timer was started
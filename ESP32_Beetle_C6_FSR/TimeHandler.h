@@ -1,29 +1,36 @@
 #ifndef TIME_HANDLER_H
 #define TIME_HANDLER_H
 
-#include <Arduino.h>
+#include <stdint.h>
+#include "Hal.h"
 
+// Round stopwatch on the 64-bit microsecond clock. Pause/resume keep the
+// elapsed time to the microsecond and nothing wraps with uptime; the ms and
+// s accessors are derived from the same count.
 class TimeHandler {
 private:
-  unsigned long startCountTime;
-  unsigned long elapsedTime;
+  Clock& clock;
+  uint64_t startMicros;    // clock time the running count is measured from
+  uint64_t elapsedMicros;  // frozen count while not running
   bool isRunning;
 
-  unsigned long pausedTime;
-  unsigned long resumedTime;
+  uint64_t pausedMicros;
+  uint64_t resumedMicros;
 
 public:
-  TimeHandler();
+  TimeHandler(Clock& clock);
   void start();
   void pause();
   void reset();
   void resume();
   void restart();  // New method to reset and start the timer
+  void restartFrom(uint64_t carriedMicros);  // restart with carriedMicros already counted
 
+  uint64_t getElapsedMicros();
   unsigned long getElapsedMilliseconds();
   unsigned long getElapsedSeconds();
-  unsigned long getPausedTime();
-  unsigned long getResumedTime();
+  unsigned long getPausedTime();   // seconds into the round at the last pause
+  unsigned long getResumedTime();  // seconds into the round at the last resume
   unsigned long getTimeSinceStart();  // New method to get time since start
 };
 
@@ -0,0 +1,159 @@
+// WaveformPacket.h
+#ifndef WAVEFORM_PACKET_H
+#define WAVEFORM_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Hal.h"
+
+// Raw multi-channel ADC samples streamed for diagnostics
+// ({"Waveform":{"Stream":true}}), one packet per notification, packed up
+// to the negotiated MTU. Little-endian:
+//
+//   0     marker   0xB9
+//   1     channels
+//   2-3   seq      packet number, wraps
+//   4-7   frame    index of the first frame, counted at the sample rate
+//                  from the first frame of the stream
+//   8-11  dropped  frames lost since the stream started
+//   12    frames   frames in this packet, consecutive
+//   13..  samples  frame by frame, channel by channel: the zig-zag varint
+//                  of the difference to the same channel one frame earlier
+//                  (to 0 for the first frame of a packet)
+//
+// Every packet decodes on its own, so a lost notification costs only its
+// frames. Idle pads change by a few mV per frame: one byte per sample.
+// Like the punch frame marker, 0xB9 never starts a UTF-8 string.
+static const uint8_t kWaveformMarker = 0xB9;
+static const size_t kWaveformHeaderSize = 13;
+static const size_t kWaveformMaxPacket = 244;  // MTU 247
+static const size_t kWaveformMaxFrames = 255;
+
+struct WaveformHeader {
+  uint8_t channels;
+  uint16_t seq;
+  uint32_t firstFrame;
+  uint32_t dropped;
+  uint8_t frames;
+};
+
+inline size_t writeWaveformVarint(int32_t delta, uint8_t* out) {
+  uint32_t value = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);  // zig-zag
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+// Fills one packet frame by frame; the caller sends it and begins the next.
+class WaveformEncoder {
+public:
+  WaveformEncoder()
+    : packet(nullptr), capacity(0), length(0), channels(0), frames(0), previous() {}
+
+  // capacity: payload limit of one notification, at most kWaveformMaxPacket
+  void begin(uint8_t* out, size_t outCapacity, uint8_t channelCount, const WaveformHeader& header) {
+    packet = out;
+    capacity = outCapacity;
+    channels = channelCount;
+    frames = 0;
+    for (size_t ch = 0; ch < kMaxAnalogChannels; ch++) {
+      previous[ch] = 0;
+    }
+    packet[0] = kWaveformMarker;
+    packet[1] = channels;
+    packet[2] = (uint8_t)header.seq;
+    packet[3] = (uint8_t)(header.seq >> 8);
+    for (int i = 0; i < 4; i++) {
+      packet[4 + i] = (uint8_t)(header.firstFrame >> (8 * i));
+      packet[8 + i] = (uint8_t)(header.dropped >> (8 * i));
+    }
+    packet[12] = 0;
+    length = kWaveformHeaderSize;
+  }
+
+  // false when the frame does not fit; the packet is unchanged then.
+  bool add(const uint16_t* millivolts) {
+    uint8_t encoded[kMaxAnalogChannels * 3];  // 17-bit zig-zag: 3 bytes at most
+    size_t encodedLength = 0;
+    for (size_t ch = 0; ch < channels; ch++) {
+      encodedLength += writeWaveformVarint((int32_t)millivolts[ch] - previous[ch], encoded + encodedLength);
+    }
+    if (frames >= kWaveformMaxFrames || length + encodedLength > capacity) {
+      return false;
+    }
+    for (size_t i = 0; i < encodedLength; i++) {
+      packet[length + i] = encoded[i];
+    }
+    length += encodedLength;
+    for (size_t ch = 0; ch < channels; ch++) {
+      previous[ch] = millivolts[ch];
+    }
+    packet[12] = (uint8_t)++frames;
+    return true;
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+  uint8_t getFrames() const {
+    return frames;
+  }
+
+private:
+  uint8_t* packet;
+  size_t capacity;
+  size_t length;
+  uint8_t channels;
+  uint8_t frames;
+  int32_t previous[kMaxAnalogChannels];
+};
+
+// Decodes one packet into out[frame][channel]. Returns the number of
+// frames, or -1 for anything that is not a complete waveform packet.
+inline int decodeWaveformPacket(const uint8_t* data, size_t length, WaveformHeader& header,
+                                uint16_t (*out)[kMaxAnalogChannels], size_t maxFrames) {
+  if (length < kWaveformHeaderSize || data[0] != kWaveformMarker) {
+    return -1;
+  }
+  header.channels = data[1];
+  header.seq = (uint16_t)(data[2] | (data[3] << 8));
+  header.firstFrame = 0;
+  header.dropped = 0;
+  for (int i = 0; i < 4; i++) {
+    header.firstFrame |= (uint32_t)data[4 + i] << (8 * i);
+    header.dropped |= (uint32_t)data[8 + i] << (8 * i);
+  }
+  header.frames = data[12];
+  if (header.channels == 0 || header.channels > kMaxAnalogChannels || header.frames > maxFrames) {
+    return -1;
+  }
+
+  int32_t previous[kMaxAnalogChannels] = { 0 };
+  size_t position = kWaveformHeaderSize;
+  for (size_t frame = 0; frame < header.frames; frame++) {
+    for (size_t ch = 0; ch < header.channels; ch++) {
+      uint32_t value = 0;
+      int shift = 0;
+      uint8_t byte;
+      do {
+        if (position >= length || shift > 28) {
+          return -1;
+        }
+        byte = data[position++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+      int32_t delta = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+      previous[ch] += delta;
+      out[frame][ch] = (uint16_t)previous[ch];
+    }
+  }
+  return position == length ? (int)header.frames : -1;
+}
+
+#endif  // WAVEFORM_PACKET_H
@@ -0,0 +1,130 @@
+// WaveformStream.h
+#ifndef WAVEFORM_STREAM_H
+#define WAVEFORM_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "CommandQueue.h"
+#include "WaveformPacket.h"
+
+// Packs sampled frames into waveform packets (WaveformPacket.h) for the
+// raw diagnostics stream. The sampling task adds frames; full packets go
+// to a queue that the protocol task drains into notifications, so the
+// sampling task never waits on the radio. A packet that finds the queue
+// full is dropped and its frames counted, as are frames the sampler
+// reports lost (addDropped), and every packet carries the total.
+class WaveformStream {
+public:
+  typedef CommandQueue<8, kWaveformMaxPacket + 1> PacketQueue;
+
+  WaveformStream()
+    : channels(0), payloadLimit(0), started(false), nextFrame(0), seq(0), dropped(0), frames(0) {}
+
+  // Protocol task, before the sampling task adds frames.
+  void start(uint8_t channelCount, size_t payload) {
+    channels = channelCount;
+    payloadLimit = payload < kWaveformMaxPacket ? payload : kWaveformMaxPacket;
+    started = false;
+    nextFrame = 0;
+    seq = 0;
+    dropped = 0;
+    frames = 0;
+    char discard[PacketQueue::kSlotSize];
+    while (packets.pop(discard, sizeof(discard)) > 0) {
+    }
+  }
+
+  // Sampling task. Returns true when a packet was queued.
+  bool addFrame(const uint16_t* millivolts) {
+    bool queued = false;
+    if (!started) {
+      started = true;
+      beginPacket();
+    }
+    if (!encoder.add(millivolts)) {
+      queued = finishPacket() || queued;
+      beginPacket();
+      encoder.add(millivolts);
+    }
+    nextFrame++;
+    frames.fetch_add(1, std::memory_order_relaxed);
+    return queued;
+  }
+
+  // Sampling task: frames the source lost before the next addFrame(). The
+  // next packet starts at the index after them. Returns true when the open
+  // packet was queued.
+  bool addDropped(uint32_t count) {
+    if (count == 0) {
+      return false;
+    }
+    dropped.fetch_add(count, std::memory_order_relaxed);
+    if (!started) {
+      nextFrame += count;
+      return false;
+    }
+    bool queued = finishPacket();
+    nextFrame += count;
+    beginPacket();
+    return queued;
+  }
+
+  // Sampling task: queues the open packet, e.g. when the stream stops.
+  bool flush() {
+    if (!started) {
+      return false;
+    }
+    bool queued = finishPacket();
+    beginPacket();
+    return queued;
+  }
+
+  // Protocol task: copies the next packet into out; 0 when none waits.
+  size_t popPacket(uint8_t* out, size_t outSize) {
+    return packets.pop((char*)out, outSize);
+  }
+
+  uint32_t getFrames() {
+    return frames.load(std::memory_order_relaxed);
+  }
+
+  uint32_t getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  void beginPacket() {
+    WaveformHeader header;
+    header.seq = seq;
+    header.firstFrame = nextFrame;
+    header.dropped = dropped.load(std::memory_order_relaxed);
+    encoder.begin(packet, payloadLimit, channels, header);
+  }
+
+  bool finishPacket() {
+    uint8_t count = encoder.getFrames();
+    if (count == 0) {
+      return false;
+    }
+    seq++;
+    if (!packets.push((const char*)packet, encoder.size())) {
+      dropped.fetch_add(count, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  PacketQueue packets;
+  WaveformEncoder encoder;
+  uint8_t packet[kWaveformMaxPacket];
+  uint8_t channels;
+  size_t payloadLimit;
+  bool started;
+  uint32_t nextFrame;
+  uint16_t seq;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> frames;
+};
+
+#endif  // WAVEFORM_STREAM_H
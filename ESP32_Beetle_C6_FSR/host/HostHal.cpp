@@ -0,0 +1,112 @@
+// HostHal.cpp
+#include "HostHal.h"
+#include <chrono>
+#include <cstdio>
+
+static unsigned long long steadyMicros() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+SteadyClock::SteadyClock()
+  : originMicros(steadyMicros()) {}
+
+unsigned long SteadyClock::millis() {
+  return (unsigned long)((steadyMicros() - originMicros) / 1000ULL);
+}
+
+unsigned long SteadyClock::micros() {
+  return (unsigned long)(steadyMicros() - originMicros);
+}
+
+uint64_t SteadyClock::micros64() {
+  return steadyMicros() - originMicros;
+}
+
+ManualClock::ManualClock()
+  : nowMicros(0) {}
+
+unsigned long ManualClock::millis() {
+  return (unsigned long)(nowMicros / 1000ULL);
+}
+
+unsigned long ManualClock::micros() {
+  return (unsigned long)nowMicros;
+}
+
+uint64_t ManualClock::micros64() {
+  return nowMicros;
+}
+
+void ManualClock::setMicros(unsigned long long now) {
+  nowMicros = now;
+}
+
+void ManualClock::advanceMicros(unsigned long long delta) {
+  nowMicros += delta;
+}
+
+void StdoutLogger::log(const char* line) {
+  std::puts(line);
+}
+
+RecordingTransport::RecordingTransport()
+  : connected(true) {}
+
+void RecordingTransport::sendMessage(const char* message) {
+  messages.emplace_back(message);
+}
+
+void RecordingTransport::sendBytes(const uint8_t* data, size_t length) {
+  frames.emplace_back(data, data + length);
+}
+
+bool RecordingTransport::isDeviceConnected() {
+  return connected;
+}
+
+void RecordingTransport::setConnected(bool isConnected) {
+  connected = isConnected;
+}
+
+BufferedAnalogSource::BufferedAnalogSource(uint8_t channelCount)
+  : channels(channelCount < kMaxAnalogChannels ? channelCount : kMaxAnalogChannels),
+    position(0) {}
+
+bool BufferedAnalogSource::begin() {
+  position = 0;
+  return true;
+}
+
+uint8_t BufferedAnalogSource::channelCount() {
+  return channels;
+}
+
+size_t BufferedAnalogSource::readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                                        uint64_t* timesUs,
+                                        size_t maxFrames) {
+  size_t frames = 0;
+  while (frames < maxFrames && position < times.size()) {
+    const uint16_t* frame = &samples[position * channels];
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      out[frames][ch] = frame[ch];
+    }
+    timesUs[frames] = times[position];
+    frames++;
+    position++;
+  }
+  return frames;
+}
+
+void BufferedAnalogSource::addFrame(const uint16_t* millivolts, uint64_t timeUs) {
+  samples.insert(samples.end(), millivolts, millivolts + channels);
+  times.push_back(timeUs);
+}
+
+void BufferedAnalogSource::rewind() {
+  position = 0;
+}
+
+size_t BufferedAnalogSource::frameCount() const {
+  return times.size();
+}
@@ -0,0 +1,79 @@
+// HostHal.h
+// Host implementations of the Hal.h interfaces, for running the firmware
+// core off-device (replay, benchmarks, tests).
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <string>
+#include <vector>
+#include "Hal.h"
+
+// Wall-clock time since construction.
+class SteadyClock : public Clock {
+public:
+  SteadyClock();
+  unsigned long millis() override;
+  unsigned long micros() override;
+  uint64_t micros64() override;
+
+private:
+  unsigned long long originMicros;
+};
+
+// Time that only moves when told to; lets traces run faster than real time.
+class ManualClock : public Clock {
+public:
+  ManualClock();
+  unsigned long millis() override;
+  unsigned long micros() override;
+  uint64_t micros64() override;
+  void setMicros(unsigned long long now);
+  void advanceMicros(unsigned long long delta);
+
+private:
+  unsigned long long nowMicros;
+};
+
+class StdoutLogger : public Logger {
+public:
+  void log(const char* line) override;
+};
+
+// Keeps every message sent so callers can inspect them afterwards.
+class RecordingTransport : public Transport {
+public:
+  RecordingTransport();
+  void sendMessage(const char* message) override;
+  void sendBytes(const uint8_t* data, size_t length) override;
+  bool isDeviceConnected() override;
+  void setConnected(bool connected);
+
+  std::vector<std::string> messages;
+  std::vector<std::vector<uint8_t>> frames;
+
+private:
+  bool connected;
+};
+
+// Serves pre-recorded frames (mV per channel + capture time) in blocks.
+class BufferedAnalogSource : public AnalogSource {
+public:
+  explicit BufferedAnalogSource(uint8_t channels);
+  bool begin() override;
+  uint8_t channelCount() override;
+  size_t readFrames(uint16_t (*out)[kMaxAnalogChannels],
+                    uint64_t* timesUs,
+                    size_t maxFrames) override;
+
+  void addFrame(const uint16_t* millivolts, uint64_t timeUs);
+  void rewind();
+  size_t frameCount() const;
+
+private:
+  uint8_t channels;
+  std::vector<uint16_t> samples;  // frame-major, channels per frame
+  std::vector<uint64_t> times;
+  size_t position;
+};
+
+#endif  // HOST_HAL_H
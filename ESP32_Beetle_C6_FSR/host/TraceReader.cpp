@@ -0,0 +1,162 @@
+// TraceReader.cpp
+#include "TraceReader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const char kTraceMagic[4] = { 'F', 'S', 'R', 'T' };
+static const uint16_t kTraceVersion = 1;
+
+static bool hasBinaryMagic(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[4] = { 0 };
+  in.read(magic, sizeof(magic));
+  return in.gcount() == sizeof(magic) && std::memcmp(magic, kTraceMagic, sizeof(magic)) == 0;
+}
+
+static bool loadBinaryTrace(const std::string& path, Trace& trace, std::string& error) {
+  std::ifstream in(path, std::ios::binary);
+  uint8_t header[12];
+  in.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (in.gcount() != sizeof(header)) {
+    error = "truncated header";
+    return false;
+  }
+  uint16_t version = header[4] | (header[5] << 8);
+  if (version != kTraceVersion) {
+    error = "unsupported trace version " + std::to_string(version);
+    return false;
+  }
+  trace.channels = header[6];
+  trace.sampleRateHz = header[8] | (header[9] << 8) | (header[10] << 16) | ((uint32_t)header[11] << 24);
+  if (trace.channels == 0 || trace.sampleRateHz == 0) {
+    error = "header has no channels or no sample rate";
+    return false;
+  }
+
+  std::vector<uint8_t> frame(trace.channels * 2);
+  uint64_t index = 0;
+  while (in.read(reinterpret_cast<char*>(frame.data()), frame.size())) {
+    for (uint8_t ch = 0; ch < trace.channels; ch++) {
+      trace.samples.push_back(frame[ch * 2] | (frame[ch * 2 + 1] << 8));
+    }
+    trace.timesUs.push_back(index * 1000000ULL / trace.sampleRateHz);
+    index++;
+  }
+  return true;
+}
+
+static void splitCsv(const std::string& line, std::vector<std::string>& fields) {
+  fields.clear();
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+}
+
+static bool loadCsvTrace(const std::string& path, Trace& trace, std::string& error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = "cannot open " + path;
+    return false;
+  }
+
+  std::string line;
+  std::vector<std::string> fields;
+  bool hasLabel = false;
+  size_t lineNumber = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    splitCsv(line, fields);
+    if (fields.size() < 2) {
+      error = "line " + std::to_string(lineNumber) + ": expected time and at least one channel";
+      return false;
+    }
+
+    // Header line: column names instead of numbers
+    if (trace.frameCount() == 0 && trace.channels == 0
+        && (fields[0].empty() || (fields[0][0] < '0' || fields[0][0] > '9'))) {
+      hasLabel = fields.back() == "label";
+      trace.channels = fields.size() - 1 - (hasLabel ? 1 : 0);
+      continue;
+    }
+    if (trace.channels == 0) {
+      trace.channels = fields.size() - 1;
+    }
+    if (fields.size() != 1u + trace.channels + (hasLabel ? 1u : 0u)) {
+      error = "line " + std::to_string(lineNumber) + ": wrong number of columns";
+      return false;
+    }
+
+    uint64_t timeUs = std::strtoull(fields[0].c_str(), nullptr, 10);
+    for (uint8_t ch = 0; ch < trace.channels; ch++) {
+      trace.samples.push_back((uint16_t)std::strtoul(fields[1 + ch].c_str(), nullptr, 10));
+    }
+    trace.timesUs.push_back(timeUs);
+    if (hasLabel && std::strtol(fields.back().c_str(), nullptr, 10) != 0) {
+      trace.labelsUs.push_back(timeUs);
+    }
+  }
+  return true;
+}
+
+bool loadTrace(const std::string& path, Trace& trace, std::string& error) {
+  trace = Trace();
+  bool loaded = hasBinaryMagic(path) ? loadBinaryTrace(path, trace, error)
+                                     : loadCsvTrace(path, trace, error);
+  if (loaded && trace.frameCount() == 0) {
+    error = "trace has no frames";
+    return false;
+  }
+  return loaded;
+}
+
+bool loadLabels(const std::string& path, Trace& trace, std::string& error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = "cannot open " + path;
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    trace.labelsUs.push_back((uint64_t)(std::strtod(line.c_str(), nullptr) * 1000.0));
+  }
+  return true;
+}
+
+bool writeBinaryTrace(const std::string& path, const Trace& trace, std::string& error) {
+  if (trace.sampleRateHz == 0) {
+    error = "binary traces need a fixed sample rate";
+    return false;
+  }
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    error = "cannot create " + path;
+    return false;
+  }
+  uint8_t header[12] = {
+    'F', 'S', 'R', 'T',
+    (uint8_t)(kTraceVersion & 0xFF), (uint8_t)(kTraceVersion >> 8),
+    trace.channels, 0,
+    (uint8_t)(trace.sampleRateHz & 0xFF), (uint8_t)(trace.sampleRateHz >> 8),
+    (uint8_t)(trace.sampleRateHz >> 16), (uint8_t)(trace.sampleRateHz >> 24)
+  };
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for (uint16_t mv : trace.samples) {
+    uint8_t bytes[2] = { (uint8_t)(mv & 0xFF), (uint8_t)(mv >> 8) };
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+  }
+  return (bool)out;
+}
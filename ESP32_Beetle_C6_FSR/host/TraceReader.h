@@ -0,0 +1,32 @@
+// TraceReader.h
+// Recorded multi-channel FSR traces for off-device replay.
+//
+// CSV:    one frame per line, "time_us,ch0[,ch1...][,label]". A header line
+//         naming the columns is required when the label column is present
+//         (last column called "label"); a non-zero label marks the frame
+//         where a real punch starts. Lines starting with '#' are ignored.
+// Binary: "FSRT" magic, uint16 version (1), uint8 channel count, uint8
+//         reserved, uint32 sample rate (Hz, per channel), then little-endian
+//         uint16 mV frames back to back. Frame times come from the rate.
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct Trace {
+  uint8_t channels = 0;
+  uint32_t sampleRateHz = 0;           // 0 when times come from the file
+  std::vector<uint16_t> samples;       // frame-major, channels per frame
+  std::vector<uint64_t> timesUs;       // one per frame
+  std::vector<uint64_t> labelsUs;      // ground-truth punch onsets
+
+  size_t frameCount() const { return timesUs.size(); }
+};
+
+bool loadTrace(const std::string& path, Trace& trace, std::string& error);
+bool loadLabels(const std::string& path, Trace& trace, std::string& error);  // one onset (ms) per line
+bool writeBinaryTrace(const std::string& path, const Trace& trace, std::string& error);
+
+#endif  // TRACE_READER_H
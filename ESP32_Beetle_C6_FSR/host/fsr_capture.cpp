@@ -0,0 +1,192 @@
+// fsr_capture.cpp
+// Turns a captured raw waveform stream ({"Waveform":{"Stream":true}}, see
+// WaveformPacket.h) into a binary trace for fsr_replay.
+//
+//   fsr_capture DUMP out.fsrt [--rate 2000] [--channels 3]
+//
+// DUMP is a text log of the notifications, one per line, as hex bytes:
+// either lines holding only hex ("b9 03 00 00 ...") or the
+// "value: b9 03 ..." lines of gatttool / btmon. "-" reads stdin. The rate
+// and channel count come from the {"Waveform":{"Status":"Started",...}}
+// reply when it is in the dump; --rate/--channels override it. Frames
+// the sensor dropped or that were lost with a notification are filled
+// with the last frame before them and reported, so trace times stay on
+// the sample grid.
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "TraceReader.h"
+#include "WaveformPacket.h"
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = (char)std::tolower((unsigned char)c);
+  return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// Bytes of one dump line, or false when it is not a notification.
+static bool parseHexLine(const std::string& line, std::vector<uint8_t>& bytes) {
+  std::string text = line;
+  size_t value = line.find("value:");
+  if (value != std::string::npos) {
+    text = line.substr(value + 6);
+  }
+  bytes.clear();
+  size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == ' ' || c == '\t' || c == ':' || c == '\r') {
+      i++;
+      continue;
+    }
+    if (i + 1 >= text.size() || hexValue(c) < 0 || hexValue(text[i + 1]) < 0) {
+      return false;
+    }
+    bytes.push_back((uint8_t)(hexValue(c) << 4 | hexValue(text[i + 1])));
+    i += 2;
+  }
+  return !bytes.empty();
+}
+
+static unsigned long jsonNumber(const std::string& text, const char* key) {
+  size_t at = text.find(key);
+  return at == std::string::npos ? 0 : std::strtoul(text.c_str() + at + std::string(key).size(), nullptr, 10);
+}
+
+int main(int argc, char** argv) {
+  std::string dumpPath;
+  std::string outPath;
+  uint32_t rateHz = 0;
+  unsigned channelsArg = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--rate" && hasValue) {
+      rateHz = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--channels" && hasValue) {
+      channelsArg = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+    } else if (!arg.empty() && (arg[0] != '-' || arg == "-") && dumpPath.empty()) {
+      dumpPath = arg;
+    } else if (!arg.empty() && arg[0] != '-' && outPath.empty()) {
+      outPath = arg;
+    } else {
+      std::fprintf(stderr, "usage: fsr_capture DUMP out.fsrt [--rate HZ] [--channels N]\n");
+      return 2;
+    }
+  }
+  if (dumpPath.empty() || outPath.empty()) {
+    std::fprintf(stderr, "usage: fsr_capture DUMP out.fsrt [--rate HZ] [--channels N]\n");
+    return 2;
+  }
+
+  std::ifstream file;
+  if (dumpPath != "-") {
+    file.open(dumpPath);
+    if (!file) {
+      std::fprintf(stderr, "fsr_capture: %s: cannot open\n", dumpPath.c_str());
+      return 1;
+    }
+  }
+  std::istream& in = dumpPath == "-" ? std::cin : file;
+
+  Trace trace;
+  trace.channels = (uint8_t)channelsArg;
+  uint32_t startedRateHz = 0;
+  uint32_t nextFrame = 0;
+  uint32_t filledFrames = 0;
+  uint32_t lostPackets = 0;
+  uint32_t badPackets = 0;
+  uint32_t sensorDropped = 0;
+  size_t packets = 0;
+  bool haveSeq = false;
+  uint16_t expectedSeq = 0;
+  std::vector<uint16_t> lastFrame;
+
+  std::string line;
+  std::vector<uint8_t> bytes;
+  while (std::getline(in, line)) {
+    if (!parseHexLine(line, bytes)) {
+      continue;
+    }
+    if (bytes[0] == '{') {
+      std::string text(bytes.begin(), bytes.end());
+      if (text.find("\"Waveform\"") != std::string::npos && text.find("\"Started\"") != std::string::npos) {
+        startedRateHz = (uint32_t)jsonNumber(text, "\"RateHz\":");
+        if (channelsArg == 0) {
+          trace.channels = (uint8_t)jsonNumber(text, "\"Channels\":");
+        }
+      }
+      continue;
+    }
+    if (bytes[0] != kWaveformMarker) {
+      continue;  // punch frames, journal chunks
+    }
+
+    WaveformHeader header;
+    uint16_t frames[kWaveformMaxFrames][kMaxAnalogChannels];
+    int count = decodeWaveformPacket(bytes.data(), bytes.size(), header, frames, kWaveformMaxFrames);
+    if (count < 0 || (trace.channels != 0 && header.channels != trace.channels)) {
+      badPackets++;
+      continue;
+    }
+    trace.channels = header.channels;
+    packets++;
+    if (haveSeq && header.seq != expectedSeq) {
+      lostPackets += (uint16_t)(header.seq - expectedSeq);
+    }
+    haveSeq = true;
+    expectedSeq = (uint16_t)(header.seq + 1);
+    sensorDropped = header.dropped;
+
+    if (header.firstFrame < nextFrame) {
+      continue;  // repeated notification
+    }
+    if (lastFrame.empty()) {
+      nextFrame = header.firstFrame;  // the capture may start mid-stream
+      lastFrame.assign(trace.channels, 0);
+    }
+    for (; nextFrame < header.firstFrame; nextFrame++) {
+      trace.samples.insert(trace.samples.end(), lastFrame.begin(), lastFrame.end());
+      trace.timesUs.push_back(0);
+      filledFrames++;
+    }
+    for (int f = 0; f < count; f++) {
+      lastFrame.assign(frames[f], frames[f] + trace.channels);
+      trace.samples.insert(trace.samples.end(), lastFrame.begin(), lastFrame.end());
+      trace.timesUs.push_back(0);
+      nextFrame++;
+    }
+  }
+
+  trace.sampleRateHz = rateHz != 0 ? rateHz : startedRateHz;
+  if (trace.frameCount() == 0) {
+    std::fprintf(stderr, "fsr_capture: no waveform packets in %s\n", dumpPath.c_str());
+    return 1;
+  }
+  if (trace.sampleRateHz == 0) {
+    std::fprintf(stderr, "fsr_capture: no Started reply in the dump, give --rate\n");
+    return 1;
+  }
+  for (size_t f = 0; f < trace.frameCount(); f++) {
+    trace.timesUs[f] = (uint64_t)f * 1000000ULL / trace.sampleRateHz;
+  }
+
+  std::string error;
+  if (!writeBinaryTrace(outPath, trace, error)) {
+    std::fprintf(stderr, "fsr_capture: %s: %s\n", outPath.c_str(), error.c_str());
+    return 1;
+  }
+  std::printf("packets:    %zu (%u lost in transit, %u malformed)\n", packets, (unsigned)lostPackets,
+              (unsigned)badPackets);
+  std::printf("frames:     %zu x %u channels at %lu Hz (%.1f s)\n", trace.frameCount(), (unsigned)trace.channels,
+              (unsigned long)trace.sampleRateHz, (double)trace.frameCount() / trace.sampleRateHz);
+  std::printf("filled:     %u frames (sensor dropped %u)\n", (unsigned)filledFrames, (unsigned)sensorDropped);
+  std::printf("written:    %s\n", outPath.c_str());
+  return 0;
+}
@@ -0,0 +1,682 @@
+// fsr_core_test.cpp
+// Checks of the portable core off-device. The kernels (queues, the punch
+// history and its resend window, the wire and journal formats, force
+// curves, the waveform packet, the telemetry histogram) against known
+// bytes and edge cases; the punch detectors on synthetic traces served by
+// BufferedAnalogSource; the round state machine on a ManualClock.
+// Registered with CTest; prints every failed check and exits non-zero if
+// there was one.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "CommandQueue.h"
+#include "FixedPunchDetector.h"
+#include "ForceCalibration.h"
+#include "HostHal.h"
+#include "PunchFrame.h"
+#include "PunchHistory.h"
+#include "PunchJournal.h"
+#include "RoundController.h"
+#include "SampleRing.h"
+#include "Telemetry.h"
+#include "WaveformPacket.h"
+#include "WaveformStream.h"
+
+static int failures = 0;
+
+#define CHECK(condition)                                                     \
+  do {                                                                       \
+    if (!(condition)) {                                                      \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      failures++;                                                            \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                              \
+  do {                                                                          \
+    long long actualValue = (long long)(actual);                                \
+    long long expectedValue = (long long)(expected);                            \
+    if (actualValue != expectedValue) {                                         \
+      std::printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+                  actualValue, expectedValue);                                  \
+      failures++;                                                               \
+    }                                                                           \
+  } while (0)
+
+static bool sameBytes(const uint8_t* actual, const std::vector<uint8_t>& expected) {
+  return std::memcmp(actual, expected.data(), expected.size()) == 0;
+}
+
+static void testCommandQueue() {
+  CommandQueue<4, 8> queue;
+  char out[8];
+  uint64_t stampUs = 0;
+  CHECK_EQ(queue.pop(out, sizeof(out)), 0);
+
+  // Full ring: the fifth command is dropped and counted
+  for (int i = 0; i < 4; i++) {
+    char command[2] = { (char)('a' + i), '\0' };
+    CHECK(queue.push(command, 1, 100 + i));
+  }
+  CHECK(!queue.push("e", 1, 104));
+  CHECK_EQ(queue.getDroppedCommands(), 1);
+  CHECK_EQ(queue.pending(), 4);
+
+  // Longer than a slot (the NUL needs room too): rejected, not truncated
+  CHECK(!queue.push("12345678", 8));
+  CHECK_EQ(queue.getOversizedCommands(), 1);
+
+  // In order, with the stamp given to push()
+  for (int i = 0; i < 4; i++) {
+    CHECK_EQ(queue.pop(out, sizeof(out), &stampUs), 1);
+    CHECK_EQ(out[0], 'a' + i);
+    CHECK_EQ(out[1], '\0');
+    CHECK_EQ(stampUs, 100 + i);
+  }
+  CHECK_EQ(queue.pending(), 0);
+
+  // Indices keep running past the slot count
+  for (int i = 0; i < 1000; i++) {
+    CHECK(queue.push("xyz", 3, i));
+    CHECK_EQ(queue.pop(out, sizeof(out), &stampUs), 3);
+    CHECK_EQ(stampUs, i);
+  }
+
+  // A short output buffer gets a NUL-terminated prefix
+  CHECK(queue.push("abcdef", 6));
+  CHECK_EQ(queue.pop(out, 4), 3);
+  CHECK(std::strcmp(out, "abc") == 0);
+}
+
+static void testSampleRing() {
+  SampleRing<2, 4> ring;
+  uint16_t frame[2];
+  uint16_t out[8][2];
+  uint64_t timesUs[8];
+  for (uint16_t i = 0; i < 5; i++) {
+    frame[0] = i;
+    frame[1] = (uint16_t)(1000 + i);
+    CHECK(ring.push(frame, 500ULL * i) == (i < 4));
+  }
+  CHECK_EQ(ring.dropped(), 1);
+  CHECK_EQ(ring.pop(out, timesUs, 8), 4);
+  CHECK_EQ(out[3][0], 3);
+  CHECK_EQ(out[3][1], 1003);
+  CHECK_EQ(timesUs[3], 1500);
+  CHECK_EQ(ring.available(), 0);
+}
+
+static void storeFrames(PunchHistory& history, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    PunchFrame punch = {};
+    punch.seq = history.getNextSeq();
+    uint8_t frame[kPunchFrameSize];
+    encodePunchFrame(punch, frame, sizeof(frame));
+    history.store(frame);
+  }
+}
+
+static void testPunchHistory() {
+  PunchHistory history;
+  size_t lost = 99;
+
+  // Nothing sent yet: a resend from 0 is just the header
+  CHECK_EQ(history.pendingSince(0), 0);
+  CHECK_EQ(history.resendStart(0, lost), 0);
+  CHECK_EQ(lost, 0);
+
+  storeFrames(history, 10);
+  CHECK_EQ(history.getNextSeq(), 10);
+  CHECK_EQ(history.pendingSince(7), 3);
+  CHECK_EQ(history.resendStart(7, lost), 7);
+  CHECK_EQ(lost, 0);
+  CHECK(history.find(9) != nullptr);
+  CHECK(history.find(10) == nullptr);
+
+  // FromSeq ahead of the newest frame (stale app cache, sensor reboot):
+  // start at nextSeq, so nothing is walked or sent
+  CHECK_EQ(history.pendingSince(50), 0);
+  CHECK_EQ(history.resendStart(50, lost), 10);
+  CHECK_EQ(lost, 0);
+
+  // Older than the ring: resend from the oldest held, report the rest lost
+  storeFrames(history, 300);
+  CHECK_EQ(history.getOldestSeq(), 310 - PunchHistory::kCapacity);
+  CHECK_EQ(history.resendStart(3, lost), 310 - PunchHistory::kCapacity);
+  CHECK_EQ(lost, 310 - PunchHistory::kCapacity - 3);
+  CHECK(history.find(53) == nullptr);
+  CHECK(history.find(54) != nullptr);
+
+  // Across the 16-bit wrap
+  storeFrames(history, 65536 - 310 + 2);  // nextSeq == 2
+  CHECK_EQ(history.getNextSeq(), 2);
+  CHECK_EQ(history.pendingSince(65534), 4);
+  CHECK_EQ(history.resendStart(65534, lost), 65534);
+  CHECK_EQ(lost, 0);
+  const uint8_t* stored = history.find(65535);
+  PunchFrame decoded;
+  CHECK(stored != nullptr && decodePunchFrame(stored, kPunchFrameSize, decoded));
+  CHECK_EQ(decoded.seq, 65535);
+}
+
+static void testPunchFrame() {
+  PunchFrame punch = {};
+  punch.device = PunchDeviceBlueBoxer;
+  punch.seq = 0x1234;
+  punch.punchCount = 5;
+  punch.timeUs = 0x01020304;
+  punch.peakMv = 3000;
+  punch.zoneMask = 0x05;
+  punch.flags = kPunchFlagForceCalibrated;
+  punch.forceDn = 0x0102;
+  uint8_t frame[kPunchFrameSize];
+  CHECK_EQ(encodePunchFrame(punch, frame, sizeof(frame) - 1), 0);
+  CHECK_EQ(encodePunchFrame(punch, frame, sizeof(frame)), 16);
+  CHECK(sameBytes(frame, { 0xB2, 0x01, 0x34, 0x12, 0x05, 0x00, 0x04, 0x03,
+                           0x02, 0x01, 0xB8, 0x0B, 0x05, 0x01, 0x02, 0x01 }));
+
+  PunchFrame decoded;
+  CHECK(decodePunchFrame(frame, sizeof(frame), decoded));
+  CHECK_EQ(decoded.timeUs, 0x01020304);
+  CHECK_EQ(decoded.forceDn, 0x0102);
+  CHECK(!decodePunchFrame(frame, sizeof(frame) - 1, decoded));
+  frame[0] = 0xB1;  // version 1 marker
+  CHECK(!decodePunchFrame(frame, sizeof(frame), decoded));
+}
+
+static void testJournalRecord() {
+  // CRC-16/CCITT-FALSE check value
+  const char* check = "123456789";
+  CHECK_EQ(journalCrc16((const uint8_t*)check, 9), 0x29B1);
+
+  JournalRecord record = {};
+  record.round = 3;
+  record.session = 0x0102;
+  for (size_t i = 0; i < kPunchFrameSize; i++) {
+    record.frame[i] = (uint8_t)i;
+  }
+  uint8_t bytes[kJournalRecordSize];
+  CHECK_EQ(kJournalRecordSize, 22);
+  CHECK_EQ(encodeJournalRecord(record, bytes, sizeof(bytes)), 22);
+  CHECK(sameBytes(bytes, { 0x5B, 0x03, 0x02, 0x01 }));
+  uint16_t crc = journalCrc16(bytes, 20);
+  CHECK_EQ(bytes[20], crc & 0xFF);
+  CHECK_EQ(bytes[21], crc >> 8);
+
+  JournalRecord decoded;
+  CHECK(decodeJournalRecord(bytes, sizeof(bytes), decoded));
+  CHECK_EQ(decoded.session, 0x0102);
+  CHECK(std::memcmp(decoded.frame, record.frame, kPunchFrameSize) == 0);
+
+  // Torn write: any flipped bit fails the CRC
+  bytes[10] ^= 0x40;
+  CHECK(!decodeJournalRecord(bytes, sizeof(bytes), decoded));
+  bytes[10] ^= 0x40;
+  bytes[0] = 0x5A;  // version 1 record
+  CHECK(!decodeJournalRecord(bytes, sizeof(bytes), decoded));
+}
+
+static void testForceCurve() {
+  ForceCurve curve;
+  CHECK(!curve.isCalibrated());
+  CHECK_EQ(curve.forceDn(2000), 0);
+
+  const ForcePoint points[] = { { 200, 0 }, { 1200, 500 }, { 2400, 2000 } };
+  CHECK(curve.set(points, 3));
+  CHECK(curve.isCalibrated());
+  CHECK_EQ(curve.forceDn(0), 0);
+  CHECK_EQ(curve.forceDn(100), 0);     // origin to first point: flat at 0
+  CHECK_EQ(curve.forceDn(700), 250);
+  CHECK_EQ(curve.forceDn(1200), 500);  // on a knot
+  CHECK_EQ(curve.forceDn(1800), 1250);
+  CHECK_EQ(curve.forceDn(3000), 2750); // past the last point: last slope
+  CHECK_EQ(curve.forceDn(65535), 65535);  // saturates
+
+  // Rejected: out of order, too close, decreasing force; the old curve stays
+  const ForcePoint unordered[] = { { 1200, 500 }, { 200, 0 } };
+  const ForcePoint tooClose[] = { { 200, 0 }, { 250, 100 } };
+  const ForcePoint decreasing[] = { { 200, 500 }, { 1200, 100 } };
+  CHECK(!curve.set(unordered, 2));
+  CHECK(!curve.set(tooClose, 2));
+  CHECK(!curve.set(decreasing, 2));
+  CHECK_EQ(curve.forceDn(700), 250);
+
+  // One point: straight line through the origin
+  const ForcePoint single[] = { { 1000, 1000 } };
+  CHECK(curve.set(single, 1));
+  CHECK_EQ(curve.forceDn(500), 500);
+  CHECK_EQ(curve.forceDn(2000), 2000);
+
+  CHECK(curve.set(nullptr, 0));
+  CHECK(!curve.isCalibrated());
+}
+
+static void testWaveformPacket() {
+  // Zig-zag varints: small deltas of either sign take one byte
+  uint8_t varint[5];
+  CHECK_EQ(writeWaveformVarint(0, varint), 1);
+  CHECK_EQ(varint[0], 0x00);
+  CHECK_EQ(writeWaveformVarint(-1, varint), 1);
+  CHECK_EQ(varint[0], 0x01);
+  CHECK_EQ(writeWaveformVarint(1, varint), 1);
+  CHECK_EQ(varint[0], 0x02);
+  CHECK_EQ(writeWaveformVarint(-64, varint), 1);
+  CHECK_EQ(varint[0], 0x7F);
+  CHECK_EQ(writeWaveformVarint(300, varint), 2);
+  CHECK(sameBytes(varint, { 0xD8, 0x04 }));
+  CHECK_EQ(writeWaveformVarint(-65535, varint), 3);
+
+  // Known packet: one channel, 100 -> 99 -> 300 mV
+  uint8_t packet[kWaveformMaxPacket];
+  WaveformHeader header = {};
+  header.seq = 0x0102;
+  header.firstFrame = 0x03040506;
+  header.dropped = 7;
+  WaveformEncoder encoder;
+  encoder.begin(packet, sizeof(packet), 1, header);
+  const uint16_t samples[] = { 100, 99, 300 };
+  for (uint16_t sample : samples) {
+    CHECK(encoder.add(&sample));
+  }
+  CHECK_EQ(encoder.size(), 18);
+  CHECK(sameBytes(packet, { 0xB9, 0x01, 0x02, 0x01, 0x06, 0x05, 0x04, 0x03, 0x07, 0x00, 0x00, 0x00,
+                            0x03, 0xC8, 0x01, 0x01, 0x92, 0x03 }));
+
+  // Round trip of full-scale swings, and every packet stands alone
+  uint16_t decoded[kWaveformMaxFrames][kMaxAnalogChannels];
+  WaveformHeader decodedHeader = {};
+  CHECK_EQ(decodeWaveformPacket(packet, encoder.size(), decodedHeader, decoded, kWaveformMaxFrames), 3);
+  CHECK_EQ(decodedHeader.firstFrame, 0x03040506);
+  CHECK_EQ(decodedHeader.dropped, 7);
+  CHECK_EQ(decoded[1][0], 99);
+  CHECK_EQ(decoded[2][0], 300);
+
+  const uint16_t swings[][3] = { { 0, 3300, 65535 }, { 65535, 0, 1 }, { 0, 3300, 65535 } };
+  encoder.begin(packet, sizeof(packet), 3, header);
+  for (const uint16_t* swing : swings) {
+    CHECK(encoder.add(swing));
+  }
+  size_t exactFit = encoder.size();
+  encoder.begin(packet, exactFit, 3, header);
+  for (const uint16_t* swing : swings) {
+    CHECK(encoder.add(swing));
+  }
+  CHECK(!encoder.add(swings[0]));  // payload limit reached: the frame waits for the next packet
+  int frames = decodeWaveformPacket(packet, encoder.size(), decodedHeader, decoded, kWaveformMaxFrames);
+  CHECK_EQ(frames, 3);
+  for (int f = 0; f < frames; f++) {
+    for (int ch = 0; ch < 3; ch++) {
+      CHECK_EQ(decoded[f][ch], swings[f][ch]);
+    }
+  }
+  // Truncated or padded packets are refused
+  CHECK_EQ(decodeWaveformPacket(packet, encoder.size() - 1, decodedHeader, decoded, kWaveformMaxFrames), -1);
+  CHECK_EQ(decodeWaveformPacket(packet, encoder.size() + 1, decodedHeader, decoded, kWaveformMaxFrames), -1);
+}
+
+static void testWaveformStream() {
+  WaveformStream stream;
+  stream.start(2, 64);  // 13-byte header + 2 bytes per idle frame
+  uint16_t frame[2] = { 150, 160 };
+  for (int i = 0; i < 30; i++) {
+    stream.addFrame(frame);
+  }
+  // Sampler losses start a new packet at the index after them
+  CHECK(stream.addDropped(5));
+  for (int i = 0; i < 3; i++) {
+    stream.addFrame(frame);
+  }
+  stream.flush();
+  CHECK_EQ(stream.getFrames(), 33);
+  CHECK_EQ(stream.getDropped(), 5);
+
+  uint8_t packet[WaveformStream::PacketQueue::kSlotSize];
+  uint16_t decoded[kWaveformMaxFrames][kMaxAnalogChannels];
+  WaveformHeader header = {};
+  uint32_t expectedFrame = 0;
+  size_t length;
+  size_t packets = 0;
+  while ((length = stream.popPacket(packet, sizeof(packet))) > 0) {
+    int frames = decodeWaveformPacket(packet, length, header, decoded, kWaveformMaxFrames);
+    CHECK(frames > 0);
+    CHECK_EQ(header.seq, packets);
+    if (expectedFrame == 30) {
+      expectedFrame += 5;
+      CHECK_EQ(header.dropped, 5);
+    }
+    CHECK_EQ(header.firstFrame, expectedFrame);
+    expectedFrame += frames;
+    packets++;
+  }
+  CHECK_EQ(expectedFrame, 38);
+}
+
+static void testHistogram() {
+  Histogram<8> powers;
+  CHECK_EQ(powers.percentile(500), 0);  // empty
+  for (int i = 0; i < 10; i++) {
+    powers.record(5);  // bucket [4, 8)
+  }
+  powers.record(100);  // last bucket takes everything above
+  CHECK_EQ(powers.getBucket(3), 10);
+  CHECK_EQ(powers.getBucket(7), 1);
+  CHECK_EQ(powers.percentile(500), 7);    // bucket's upper edge
+  CHECK_EQ(powers.percentile(990), 100);  // rank 11 is in the last bucket
+  powers.record(0);
+  CHECK_EQ(powers.getBucket(0), 1);
+
+  Histogram<4> linear(10);
+  linear.record(15);
+  CHECK_EQ(linear.percentile(500), 15);  // upper edge 19, clipped to the max
+  linear.record(25);
+  linear.record(1000);
+  CHECK_EQ(linear.getBucket(3), 1);
+  CHECK_EQ(linear.percentile(1000), 1000);
+  linear.reset();
+  CHECK_EQ(linear.getCount(), 0);
+}
+
+// Synthetic pad trace at 2 kHz: idle level plus optional noise, and
+// triangular hits rising for 10 ms and falling for 20 ms.
+struct Hit {
+  size_t channel;
+  uint64_t onsetUs;
+  uint16_t peakMv;
+};
+
+static const uint64_t kFramePeriodUs = 500;
+
+static void fillTrace(BufferedAnalogSource& source, uint8_t channels, uint64_t lengthUs,
+                      const std::vector<Hit>& hits, uint16_t idleMv = 0, uint16_t noiseMv = 0) {
+  uint32_t random = 12345;
+  for (uint64_t timeUs = 0; timeUs < lengthUs; timeUs += kFramePeriodUs) {
+    uint16_t frame[kMaxAnalogChannels] = {};
+    for (size_t ch = 0; ch < channels; ch++) {
+      int mv = idleMv;
+      if (noiseMv > 0) {
+        random = random * 1103515245 + 12345;
+        mv += (int)((random >> 16) % (2 * noiseMv + 1)) - noiseMv;
+      }
+      for (const Hit& hit : hits) {
+        if (hit.channel != ch || timeUs < hit.onsetUs || timeUs >= hit.onsetUs + 30000) {
+          continue;
+        }
+        uint64_t offsetUs = timeUs - hit.onsetUs;
+        int rise = offsetUs < 10000 ? (int)(hit.peakMv * offsetUs / 10000)
+                                    : (int)(hit.peakMv * (30000 - offsetUs) / 20000);
+        mv += rise;
+      }
+      frame[ch] = (uint16_t)(mv < 0 ? 0 : mv);
+    }
+    source.addFrame(frame, timeUs);
+  }
+}
+
+static std::vector<PunchEvent> detect(FSRPunchDetector& detector, AnalogSource& source) {
+  std::vector<PunchEvent> events;
+  detector.setup(&source, nullptr);
+  while (detector.checkPunch()) {
+    events.push_back(detector.getLastPunch());
+  }
+  return events;
+}
+
+static std::vector<PunchEvent> detectFixed(BufferedAnalogSource& source) {
+  FSRPunchDetector detector({ 4, 5, 6 }, 800, 200);
+  detector.setAdaptive(false);
+  return detect(detector, source);
+}
+
+static void testDetectorZones() {
+  BufferedAnalogSource source(3);
+  fillTrace(source, 3, 1000000, { { 1, 300000, 2500 } });
+  std::vector<PunchEvent> events = detectFixed(source);
+  CHECK_EQ(events.size(), 1);
+  if (events.size() == 1) {
+    const PunchEvent& punch = events[0];
+    CHECK_EQ(punch.zoneMask, 0x02);
+    CHECK_EQ(punch.peakMv[0], 0);
+    CHECK_EQ(punch.peakMv[1], 2500);
+    CHECK_EQ(punch.features.peakMv, 2500);
+    CHECK_EQ(punch.onsetUs, 303500);  // first frame above 800 mV
+    CHECK_EQ(punch.timeMs, 303);
+    CHECK(punch.completedUs > punch.onsetUs + 20000);
+    CHECK(!punch.forceCalibrated);
+  }
+}
+
+static void testDetectorCoincidence() {
+  // Second pad 8 ms after the first: one punch on both zones
+  BufferedAnalogSource together(3);
+  fillTrace(together, 3, 1000000, { { 0, 300000, 2000 }, { 2, 308000, 3000 } });
+  std::vector<PunchEvent> events = detectFixed(together);
+  CHECK_EQ(events.size(), 1);
+  if (events.size() == 1) {
+    CHECK_EQ(events[0].zoneMask, 0x05);
+    CHECK_EQ(events[0].peakMv[0], 2000);
+    CHECK_EQ(events[0].peakMv[2], 3000);
+    CHECK_EQ(events[0].features.peakMv, 3000);
+    CHECK_EQ(events[0].onsetUs, 304500);
+  }
+
+  // 40 ms apart, past the coincidence window: two punches
+  BufferedAnalogSource apart(3);
+  fillTrace(apart, 3, 1000000, { { 0, 300000, 2000 }, { 2, 340000, 3000 } });
+  events = detectFixed(apart);
+  CHECK_EQ(events.size(), 2);
+  if (events.size() == 2) {
+    CHECK_EQ(events[0].zoneMask, 0x01);
+    CHECK_EQ(events[1].zoneMask, 0x04);
+  }
+}
+
+static void testDetectorDebounce() {
+  // A pad's first hit counts even right after boot
+  BufferedAnalogSource early(1);
+  fillTrace(early, 1, 500000, { { 0, 10000, 2000 } });
+  FSRPunchDetector first({ 4 }, 800, 200);
+  first.setAdaptive(false);
+  CHECK_EQ(detect(first, early).size(), 1);
+
+  // 150 ms after the last trigger is the same punch bouncing, 250 ms is a new one
+  BufferedAnalogSource bounce(1);
+  fillTrace(bounce, 1, 1000000, { { 0, 100000, 2000 }, { 0, 250000, 2000 }, { 0, 600000, 2000 } });
+  FSRPunchDetector detector({ 4 }, 800, 200);
+  detector.setAdaptive(false);
+  std::vector<PunchEvent> events = detect(detector, bounce);
+  CHECK_EQ(events.size(), 2);
+  if (events.size() == 2) {
+    CHECK(events[0].onsetUs < 120000);
+    CHECK(events[1].onsetUs > 600000);
+  }
+
+  // Debounce is per pad: another pad fires inside the first one's window
+  BufferedAnalogSource twoPads(2);
+  fillTrace(twoPads, 2, 1000000, { { 0, 100000, 2000 }, { 1, 200000, 2000 } });
+  FSRPunchDetector pads({ 4, 5 }, 800, 200);
+  pads.setAdaptive(false);
+  CHECK_EQ(detect(pads, twoPads).size(), 2);
+}
+
+static void testDetectorAdaptive() {
+  // Pad resting at 1000 mV with +-40 mV of noise; calibrate on the first
+  // 200 ms. A 600 mV bump clears the absolute 800 mV sensitivity but not
+  // baseline + 800 mV; a 1500 mV hit clears both.
+  BufferedAnalogSource source(1);
+  fillTrace(source, 1, 1500000, { { 0, 400000, 600 }, { 0, 900000, 1500 } }, 1000, 40);
+  FSRPunchDetector detector({ 4 }, 800, 200);
+  detector.setAdaptive(true);
+  detector.setup(&source, nullptr);
+  detector.startCalibration(200);
+  CHECK(detector.isCalibrating());
+  std::vector<PunchEvent> events;
+  while (detector.checkPunch()) {
+    events.push_back(detector.getLastPunch());
+  }
+  CHECK(!detector.isCalibrating());
+  int baselineMv = detector.getBaselineMv(0);
+  CHECK(baselineMv >= 990 && baselineMv <= 1010);
+  CHECK(detector.getNoiseMv(0) > 0);
+  CHECK(detector.getTriggerMv(0) >= baselineMv + 800);
+  CHECK(detector.getReleaseMv(0) >= baselineMv + 200);
+  CHECK_EQ(events.size(), 1);
+  if (events.size() == 1) {
+    CHECK(events[0].onsetUs > 900000 && events[0].onsetUs < 910000);
+    CHECK(events[0].features.peakMv > 2400);
+  }
+}
+
+// A frame gap longer than the debounce inside a coincidence window still
+// open: the pad re-arms while its old punch is unfinished (ADC drops, the
+// polled source, trace gaps).
+static void fillGapTrace(BufferedAnalogSource& source) {
+  const uint16_t high = 2000;
+  const uint16_t low = 0;
+  source.addFrame(&high, 100000);
+  source.addFrame(&low, 105000);
+  source.addFrame(&high, 400000);
+  source.addFrame(&low, 405000);
+  source.addFrame(&low, 500000);
+}
+
+static void testDetectorFrameGap() {
+  BufferedAnalogSource source(1);
+  fillGapTrace(source);
+  FSRPunchDetector detector({ 4 }, 800, 200);
+  detector.setAdaptive(false);
+  std::vector<PunchEvent> events = detect(detector, source);
+  CHECK_EQ(events.size(), 2);
+  if (events.size() == 2) {
+    CHECK_EQ(events[0].onsetUs, 100000);
+    CHECK_EQ(events[1].onsetUs, 400000);
+    CHECK_EQ(events[1].zoneMask, 0x01);
+  }
+
+  source.rewind();
+  FixedPunchDetector<4> fixed(800, 200);
+  fixed.setAdaptive(false);
+  CHECK_EQ(detect(fixed, source).size(), 2);
+}
+
+static bool sameEvents(const std::vector<PunchEvent>& a, const std::vector<PunchEvent>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].onsetUs != b[i].onsetUs || a[i].completedUs != b[i].completedUs || a[i].zoneMask != b[i].zoneMask ||
+        std::memcmp(a[i].peakMv, b[i].peakMv, sizeof(a[i].peakMv)) != 0 ||
+        a[i].features.peakMv != b[i].features.peakMv || a[i].features.widthUs != b[i].features.widthUs ||
+        a[i].features.timeToPeakUs != b[i].features.timeToPeakUs ||
+        a[i].features.impulse != b[i].features.impulse) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testFixedMatchesRuntime() {
+  std::vector<Hit> hits;
+  for (int i = 0; i < 40; i++) {
+    uint64_t onsetUs = 200000 + (uint64_t)i * 170000;
+    hits.push_back({ (size_t)(i % 3), onsetUs, (uint16_t)(1200 + 97 * i) });
+    if (i % 4 == 0) {
+      hits.push_back({ (size_t)((i + 2) % 3), onsetUs + 5000 + (uint64_t)i * 500, 1800 });
+    }
+  }
+  BufferedAnalogSource source(3);
+  fillTrace(source, 3, 8000000, hits, 100, 30);
+
+  for (bool adaptive : { false, true }) {
+    source.rewind();
+    FSRPunchDetector runtime({ 4, 5, 6 }, 800, 200);
+    runtime.setAdaptive(adaptive);
+    std::vector<PunchEvent> expected = detect(runtime, source);
+    source.rewind();
+    FixedPunchDetector<4, 5, 6> fixed(800, 200);
+    fixed.setAdaptive(adaptive);
+    std::vector<PunchEvent> actual = detect(fixed, source);
+    CHECK(expected.size() >= 40);
+    CHECK(sameEvents(expected, actual));
+  }
+}
+
+static void testRoundController() {
+  ManualClock clock;
+  TimeHandler timer(clock);
+  RoundController rounds(timer, 3000, 1000);
+  rounds.setRounds(2);
+  CHECK_EQ(rounds.update(), RoundEventNone);
+  CHECK(rounds.getMicrosToBoundary() == UINT64_MAX);
+
+  CHECK_EQ(rounds.handleCommand(RoundCommandStart), RoundEventStarted);
+  CHECK_EQ(rounds.getCurrentRound(), 1);
+  CHECK(rounds.isDetecting());
+  clock.setMicros(2999000);
+  CHECK_EQ(rounds.update(), RoundEventNone);
+  CHECK_EQ(rounds.getMicrosToBoundary(), 1000);
+
+  // Checked 2 s late: the break starts with the overshoot already counted,
+  // so the next boundary stays on the program's grid
+  clock.setMicros(5000000);
+  CHECK_EQ(rounds.update(), RoundEventBreakStarted);
+  CHECK(rounds.isInBreak());
+  CHECK(!rounds.isDetecting());
+  CHECK_EQ(rounds.update(), RoundEventRoundStarted);  // one boundary per call
+  CHECK_EQ(rounds.getCurrentRound(), 2);
+  CHECK(rounds.isDetecting());
+  CHECK_EQ(rounds.getMicrosToBoundary(), 2000000);  // round 2 ends at 7 s
+
+  // Paused time does not count
+  clock.setMicros(6000000);
+  CHECK_EQ(rounds.handleCommand(RoundCommandPause), RoundEventPaused);
+  CHECK(!rounds.isDetecting());
+  clock.setMicros(16000000);
+  CHECK_EQ(rounds.update(), RoundEventNone);
+  CHECK(rounds.getMicrosToBoundary() == UINT64_MAX);
+  CHECK_EQ(rounds.handleCommand(RoundCommandResume), RoundEventResumed);
+  CHECK_EQ(rounds.getMicrosToBoundary(), 1000000);
+  clock.setMicros(16999999);
+  CHECK_EQ(rounds.update(), RoundEventNone);
+  clock.setMicros(17000000);
+  CHECK_EQ(rounds.update(), RoundEventCompleted);
+  CHECK(!rounds.isActive());
+  CHECK(!rounds.isInBreak());
+  CHECK_EQ(rounds.update(), RoundEventNone);
+
+  // Reset restarts the current round; End stops the program
+  CHECK_EQ(rounds.handleCommand(RoundCommandStart), RoundEventStarted);
+  clock.setMicros(19000000);
+  CHECK_EQ(rounds.handleCommand(RoundCommandReset), RoundEventReset);
+  CHECK_EQ(rounds.getCurrentRound(), 1);
+  CHECK_EQ(rounds.getMicrosToBoundary(), 3000000);
+  CHECK_EQ(rounds.handleCommand(RoundCommandEnd), RoundEventEnded);
+  CHECK(!rounds.isActive());
+  clock.setMicros(30000000);
+  CHECK_EQ(rounds.update(), RoundEventNone);
+  CHECK_EQ(rounds.handleCommand(42), RoundEventUnknownCommand);
+}
+
+int main() {
+  testCommandQueue();
+  testSampleRing();
+  testPunchHistory();
+  testPunchFrame();
+  testJournalRecord();
+  testForceCurve();
+  testWaveformPacket();
+  testWaveformStream();
+  testHistogram();
+  testDetectorZones();
+  testDetectorCoincidence();
+  testDetectorDebounce();
+  testDetectorAdaptive();
+  testDetectorFrameGap();
+  testFixedMatchesRuntime();
+  testRoundController();
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,268 @@
+// fsr_fixed_bench.cpp
+// Cost per sample of the detector's signal chain in fixed point (what the
+// firmware runs: BaselineTracker, PulseTracker) against the same chain in
+// float, and how far the two drift apart.
+//
+//   fsr_fixed_bench [TRACE] [--repeat 50] [--sensitivity 800] [--threshold 200]
+//
+// Without a trace it runs on a synthetic 3-pad minute at 2 kHz. The host
+// has an FPU, so the float column is a lower bound: on the ESP32-C6 every
+// float add/multiply/divide below is a soft-float library call.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "BaselineTracker.h"
+#include "PulseTracker.h"
+#include "TraceReader.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+// The chain as it was written before the fixed-point trackers: float EMA
+// with the same time constants, float trapezoid area and a volts value.
+class FloatBaselineTracker {
+public:
+  void update(uint16_t mv) {
+    if (!seeded) {
+      baseline = mv;
+      seeded = true;
+      return;
+    }
+    float deviation = mv - baseline;
+    baseline += deviation / 4096.0f;
+    noise += (std::fabs(deviation) - noise) / 256.0f;
+  }
+  float getBaselineMv() const { return baseline; }
+  float getNoiseMv() const { return noise; }
+
+private:
+  float baseline = 0.0f;
+  float noise = 0.0f;
+  bool seeded = false;
+};
+
+class FloatPulseTracker {
+public:
+  void start(uint16_t mv, uint64_t timeUs) {
+    peakVolts = lastVolts = mv / 1000.0f;
+    lastUs = timeUs;
+    areaVoltMs = 0.0f;
+    active = true;
+  }
+  void add(uint16_t mv, uint64_t timeUs) {
+    float volts = mv / 1000.0f;
+    areaVoltMs += (lastVolts + volts) * (float)(timeUs - lastUs) / 2000.0f;
+    if (volts > peakVolts) {
+      peakVolts = volts;
+    }
+    lastVolts = volts;
+    lastUs = timeUs;
+  }
+  float finish() {
+    active = false;
+    return areaVoltMs * 1000.0f;  // mV*ms, as PulseTracker reports it
+  }
+  bool isActive() const { return active; }
+
+private:
+  float peakVolts = 0.0f;
+  float lastVolts = 0.0f;
+  float areaVoltMs = 0.0f;
+  uint64_t lastUs = 0;
+  bool active = false;
+};
+
+struct Pad {
+  BaselineTracker baseline;
+  PulseTracker pulse;
+};
+
+struct FloatPad {
+  FloatBaselineTracker baseline;
+  FloatPulseTracker pulse;
+};
+
+struct ChainResult {
+  uint64_t impulseSum = 0;
+  size_t pulses = 0;
+  double baselineMv = 0;
+  double noiseMv = 0;
+};
+
+// Same control flow for both: idle samples feed the baseline, a sample
+// over baseline + sensitivity starts a pulse, one under baseline +
+// threshold ends it.
+static ChainResult runFixed(const Trace& trace, int sensitivity, int threshold) {
+  std::vector<Pad> pads(trace.channels);
+  ChainResult result;
+  for (size_t f = 0; f < trace.frameCount(); f++) {
+    const uint16_t* frame = &trace.samples[f * trace.channels];
+    uint64_t timeUs = trace.timesUs[f];
+    for (size_t ch = 0; ch < trace.channels; ch++) {
+      Pad& pad = pads[ch];
+      int baseline = pad.baseline.getBaselineMv();
+      if (!pad.pulse.isActive()) {
+        if (frame[ch] > baseline + sensitivity) {
+          pad.pulse.start(frame[ch], timeUs);
+        } else {
+          pad.baseline.update(frame[ch]);
+        }
+      } else {
+        pad.pulse.add(frame[ch], timeUs);
+        if (frame[ch] < baseline + threshold) {
+          result.impulseSum += pad.pulse.finish().impulse;
+          result.pulses++;
+        }
+      }
+    }
+  }
+  for (const Pad& pad : pads) {
+    result.baselineMv += pad.baseline.getBaselineMv();
+    result.noiseMv += pad.baseline.getNoiseMv();
+  }
+  return result;
+}
+
+static ChainResult runFloat(const Trace& trace, int sensitivity, int threshold) {
+  std::vector<FloatPad> pads(trace.channels);
+  ChainResult result;
+  for (size_t f = 0; f < trace.frameCount(); f++) {
+    const uint16_t* frame = &trace.samples[f * trace.channels];
+    uint64_t timeUs = trace.timesUs[f];
+    for (size_t ch = 0; ch < trace.channels; ch++) {
+      FloatPad& pad = pads[ch];
+      float baseline = pad.baseline.getBaselineMv();
+      if (!pad.pulse.isActive()) {
+        if (frame[ch] > baseline + sensitivity) {
+          pad.pulse.start(frame[ch], timeUs);
+        } else {
+          pad.baseline.update(frame[ch]);
+        }
+      } else {
+        pad.pulse.add(frame[ch], timeUs);
+        if (frame[ch] < baseline + threshold) {
+          result.impulseSum += (uint64_t)pad.pulse.finish();
+          result.pulses++;
+        }
+      }
+    }
+  }
+  for (const FloatPad& pad : pads) {
+    result.baselineMv += pad.baseline.getBaselineMv();
+    result.noiseMv += pad.baseline.getNoiseMv();
+  }
+  return result;
+}
+
+// 60 s, 3 pads, 2 kHz: slow drift and noise, a punch every ~400 ms on
+// one or more pads. Deterministic so runs compare.
+static void synthesize(Trace& trace) {
+  trace.channels = 3;
+  trace.sampleRateHz = 2000;
+  uint32_t state = 12345;
+  auto next = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+  };
+  const size_t frames = 60 * trace.sampleRateHz;
+  size_t punchAt = 400;
+  uint32_t punchMask = 1;
+  for (size_t f = 0; f < frames; f++) {
+    trace.timesUs.push_back((uint64_t)f * 1000000ULL / trace.sampleRateHz);
+    if (f == punchAt + 120) {
+      punchAt += 600 + next() % 600;
+      punchMask = 1 + next() % 7;
+    }
+    for (uint8_t ch = 0; ch < trace.channels; ch++) {
+      int mv = 150 + (int)(f / 4000) + (int)(next() % 13) - 6;
+      if (f >= punchAt && f < punchAt + 120 && (punchMask >> ch) & 1) {
+        int phase = (int)(f - punchAt);
+        mv += 2400 * phase * (120 - phase) / 3600;  // parabola, 2.4 V peak
+      }
+      trace.samples.push_back((uint16_t)mv);
+    }
+  }
+}
+
+template <typename Run>
+static double costPerSample(const Trace& trace, int repeat, Run run, ChainResult& result) {
+#ifdef BENCH_HAVE_TSC
+  uint64_t started = __rdtsc();
+#else
+  auto started = std::chrono::steady_clock::now();
+#endif
+  for (int r = 0; r < repeat; r++) {
+    result = run();
+  }
+#ifdef BENCH_HAVE_TSC
+  double total = (double)(__rdtsc() - started);
+#else
+  double total = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - started)
+                   .count();
+#endif
+  return total / ((double)trace.frameCount() * trace.channels * repeat);
+}
+
+int main(int argc, char** argv) {
+  std::string tracePath;
+  int repeat = 50;
+  int sensitivity = 800;
+  int threshold = 200;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--repeat" && hasValue) {
+      repeat = std::atoi(argv[++i]);
+    } else if (arg == "--sensitivity" && hasValue) {
+      sensitivity = std::atoi(argv[++i]);
+    } else if (arg == "--threshold" && hasValue) {
+      threshold = std::atoi(argv[++i]);
+    } else if (!arg.empty() && arg[0] != '-' && tracePath.empty()) {
+      tracePath = arg;
+    } else {
+      std::fprintf(stderr, "usage: fsr_fixed_bench [TRACE] [--repeat N] [--sensitivity MV] [--threshold MV]\n");
+      return 2;
+    }
+  }
+  if (repeat <= 0) {
+    repeat = 1;
+  }
+
+  Trace trace;
+  if (tracePath.empty()) {
+    synthesize(trace);
+    tracePath = "synthetic";
+  } else {
+    std::string error;
+    if (!loadTrace(tracePath, trace, error)) {
+      std::fprintf(stderr, "fsr_fixed_bench: %s: %s\n", tracePath.c_str(), error.c_str());
+      return 1;
+    }
+  }
+
+  ChainResult fixed;
+  ChainResult floating;
+  double fixedCost = costPerSample(trace, repeat, [&]() { return runFixed(trace, sensitivity, threshold); }, fixed);
+  double floatCost = costPerSample(trace, repeat, [&]() { return runFloat(trace, sensitivity, threshold); }, floating);
+
+#ifdef BENCH_HAVE_TSC
+  const char* unit = "TSC cycles";
+#else
+  const char* unit = "ns";
+#endif
+  std::printf("trace:      %s (%zu frames x %u channels, %d runs)\n", tracePath.c_str(), trace.frameCount(),
+              (unsigned)trace.channels, repeat);
+  std::printf("fixed:      %.2f %s/sample  pulses=%zu impulse=%llu mV*ms baseline=%.0f noise=%.0f mV\n",
+              fixedCost, unit, fixed.pulses, (unsigned long long)fixed.impulseSum, fixed.baselineMv,
+              fixed.noiseMv);
+  std::printf("float:      %.2f %s/sample  pulses=%zu impulse=%llu mV*ms baseline=%.1f noise=%.1f mV\n",
+              floatCost, unit, floating.pulses, (unsigned long long)floating.impulseSum, floating.baselineMv,
+              floating.noiseMv);
+  std::printf("float/fixed %.2fx (host FPU; soft-float on the C6 costs more)\n", floatCost / fixedCost);
+  return 0;
+}
@@ -0,0 +1,216 @@
+// fsr_replay.cpp
+// Replays a recorded FSR trace through FSRPunchDetector and reports
+// detection quality against labelled punches plus detector throughput.
+//
+//   fsr_replay trace.csv [--labels onsets.txt] [--sensitivity 800]
+//              [--threshold 200] [--tolerance-ms 100] [--repeat 20]
+//              [--events] [--fixed] [--convert out.fsrt --rate 2000]
+//
+// --fixed replays through FixedPunchDetector sized to the trace's channel
+// count instead of the runtime FSRPunchDetector; detections must match.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "FSRPunchDetector.h"
+#include "FixedPunchDetector.h"
+#include "HostHal.h"
+#include "TraceReader.h"
+
+struct ReplayOptions {
+  std::string tracePath;
+  std::string labelsPath;
+  std::string convertPath;
+  int sensitivity = 800;
+  int threshold = 200;
+  unsigned long toleranceMs = 100;
+  int repeat = 20;
+  uint32_t rateHz = 0;
+  bool printEvents = false;
+  bool fixed = false;
+};
+
+struct Detection {
+  unsigned long timeMs;
+  uint8_t zoneMask;
+  PulseFeatures features;
+  bool matched;
+};
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: fsr_replay TRACE [--labels FILE] [--sensitivity MV] [--threshold MV]\n"
+               "                  [--tolerance-ms MS] [--repeat N] [--events] [--fixed]\n"
+               "                  [--convert OUT.fsrt --rate HZ]\n");
+}
+
+static bool parseArgs(int argc, char** argv, ReplayOptions& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--labels" && hasValue) {
+      options.labelsPath = argv[++i];
+    } else if (arg == "--sensitivity" && hasValue) {
+      options.sensitivity = std::atoi(argv[++i]);
+    } else if (arg == "--threshold" && hasValue) {
+      options.threshold = std::atoi(argv[++i]);
+    } else if (arg == "--tolerance-ms" && hasValue) {
+      options.toleranceMs = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--repeat" && hasValue) {
+      options.repeat = std::atoi(argv[++i]);
+    } else if (arg == "--convert" && hasValue) {
+      options.convertPath = argv[++i];
+    } else if (arg == "--rate" && hasValue) {
+      options.rateHz = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--events") {
+      options.printEvents = true;
+    } else if (arg == "--fixed") {
+      options.fixed = true;
+    } else if (!arg.empty() && arg[0] != '-' && options.tracePath.empty()) {
+      options.tracePath = arg;
+    } else {
+      return false;
+    }
+  }
+  return !options.tracePath.empty() && options.repeat > 0;
+}
+
+static void fillSource(const Trace& trace, BufferedAnalogSource& source) {
+  for (size_t i = 0; i < trace.frameCount(); i++) {
+    source.addFrame(&trace.samples[i * trace.channels], trace.timesUs[i]);
+  }
+}
+
+template <typename Detector>
+static std::vector<Detection> drain(Detector& detector, BufferedAnalogSource& source) {
+  std::vector<Detection> detections;
+  source.rewind();
+  detector.setup(&source, nullptr);
+  while (detector.checkPunch()) {
+    const PunchEvent& punch = detector.getLastPunch();
+    detections.push_back({ punch.timeMs, punch.zoneMask, punch.features, false });
+  }
+  return detections;
+}
+
+template <int... Pins>
+static std::vector<Detection> detectFixed(const ReplayOptions& options, BufferedAnalogSource& source) {
+  FixedPunchDetector<Pins...> detector(options.sensitivity, options.threshold);
+  return drain(detector, source);
+}
+
+static std::vector<Detection> detect(const ReplayOptions& options, BufferedAnalogSource& source) {
+  if (options.fixed) {
+    switch (source.channelCount()) {
+      case 1: return detectFixed<0>(options, source);
+      case 2: return detectFixed<0, 1>(options, source);
+      case 3: return detectFixed<0, 1, 2>(options, source);
+      case 4: return detectFixed<0, 1, 2, 3>(options, source);
+      case 5: return detectFixed<0, 1, 2, 3, 4>(options, source);
+      default: return detectFixed<0, 1, 2, 3, 4, 5>(options, source);
+    }
+  }
+  FSRPunchDetector detector({ 0, 1, 2, 3, 4, 5 }, options.sensitivity, options.threshold);
+  return drain(detector, source);
+}
+
+// Greedy in-order matching: each label claims the first unmatched detection
+// within the tolerance window.
+static size_t matchLabels(const Trace& trace, unsigned long toleranceMs, std::vector<Detection>& detections) {
+  size_t truePositives = 0;
+  size_t next = 0;
+  for (uint64_t labelUs : trace.labelsUs) {
+    unsigned long labelMs = (unsigned long)(labelUs / 1000ULL);
+    while (next < detections.size() && detections[next].timeMs + toleranceMs < labelMs) {
+      next++;
+    }
+    if (next < detections.size() && detections[next].timeMs <= labelMs + toleranceMs) {
+      detections[next].matched = true;
+      truePositives++;
+      next++;
+    }
+  }
+  return truePositives;
+}
+
+int main(int argc, char** argv) {
+  ReplayOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    usage();
+    return 2;
+  }
+
+  Trace trace;
+  std::string error;
+  if (!loadTrace(options.tracePath, trace, error)) {
+    std::fprintf(stderr, "fsr_replay: %s: %s\n", options.tracePath.c_str(), error.c_str());
+    return 1;
+  }
+  if (!options.labelsPath.empty() && !loadLabels(options.labelsPath, trace, error)) {
+    std::fprintf(stderr, "fsr_replay: %s: %s\n", options.labelsPath.c_str(), error.c_str());
+    return 1;
+  }
+  if (trace.channels > kMaxAnalogChannels) {
+    std::fprintf(stderr, "fsr_replay: %u channels, detector supports %u\n",
+                 (unsigned)trace.channels, (unsigned)kMaxAnalogChannels);
+    return 1;
+  }
+
+  if (!options.convertPath.empty()) {
+    if (options.rateHz != 0) {
+      trace.sampleRateHz = options.rateHz;
+    }
+    if (!writeBinaryTrace(options.convertPath, trace, error)) {
+      std::fprintf(stderr, "fsr_replay: %s: %s\n", options.convertPath.c_str(), error.c_str());
+      return 1;
+    }
+  }
+
+  BufferedAnalogSource source(trace.channels);
+  fillSource(trace, source);
+
+  // Detection quality
+  std::vector<Detection> detections = detect(options, source);
+  size_t truePositives = matchLabels(trace, options.toleranceMs, detections);
+
+  if (options.printEvents) {
+    for (const Detection& d : detections) {
+      std::printf("punch t=%lu ms zone=0x%02x peak=%u mV rise=%u us width=%u us impulse=%u mV*ms%s\n",
+                  d.timeMs, d.zoneMask, (unsigned)d.features.peakMv, (unsigned)d.features.timeToPeakUs,
+                  (unsigned)d.features.widthUs, (unsigned)d.features.impulse,
+                  trace.labelsUs.empty() ? "" : (d.matched ? "" : " FALSE POSITIVE"));
+    }
+  }
+
+  // Throughput: full replay, repeated, timed end to end
+  auto started = std::chrono::steady_clock::now();
+  size_t sink = 0;
+  for (int r = 0; r < options.repeat; r++) {
+    sink += detect(options, source).size();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - started;
+  double totalNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  double frames = (double)trace.frameCount() * options.repeat;
+
+  std::printf("trace:        %s (%zu frames x %u channels)\n", options.tracePath.c_str(),
+              trace.frameCount(), (unsigned)trace.channels);
+  std::printf("settings:     sensitivity=%d mV threshold=%d mV, %s detector\n", options.sensitivity,
+              options.threshold, options.fixed ? "fixed" : "runtime");
+  std::printf("detected:     %zu punches\n", detections.size());
+  if (!trace.labelsUs.empty()) {
+    size_t falsePositives = detections.size() - truePositives;
+    size_t missed = trace.labelsUs.size() - truePositives;
+    std::printf("labelled:     %zu punches (tolerance %lu ms)\n", trace.labelsUs.size(), options.toleranceMs);
+    std::printf("true pos:     %zu\n", truePositives);
+    std::printf("false pos:    %zu\n", falsePositives);
+    std::printf("missed:       %zu\n", missed);
+    std::printf("precision:    %.3f\n", detections.empty() ? 0.0 : (double)truePositives / detections.size());
+    std::printf("recall:       %.3f\n", (double)truePositives / trace.labelsUs.size());
+  }
+  std::printf("throughput:   %.2f ns/frame, %.2f ns/sample, %.1f M samples/s (%d runs, %zu)\n",
+              totalNs / frames, totalNs / (frames * trace.channels),
+              frames * trace.channels / totalNs * 1000.0, options.repeat, sink / options.repeat);
+  return 0;
+}
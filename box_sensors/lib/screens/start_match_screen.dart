@@ -188,6 +188,8 @@ class _StartMatchScreenState extends ConsumerState<StartMatchScreen> {
             ((widget.match?['roundTime'] ?? s['roundTime']) * 60000).toString(),
         'BreakTime':
             ((widget.match?['breakTime'] ?? s['breakTime']) * 1000).toString(),
+        // The sensors run all rounds and breaks on their own clock
+        'Rounds': (widget.match?['rounds'] ?? 1).toString(),
       },
     });
   }
@@ -3,10 +3,13 @@ import 'dart:async';
 import 'dart:convert';
 import 'dart:io' show Platform;
 import 'dart:math';
+import 'dart:typed_data';
 import 'package:flutter/material.dart';
 import 'package:flutter_blue_plus/flutter_blue_plus.dart';
 import 'package:box_sensors/state/timer_state.dart';
 import 'package:box_sensors/services/database_helper.dart';
+import 'package:box_sensors/services/clock_sync.dart';
+import 'package:box_sensors/services/sensor_diagnostics.dart';
 import 'package:sentry_flutter/sentry_flutter.dart';
 
 class BluetoothManager with ChangeNotifier {
@@ -41,6 +44,8 @@ class BluetoothManager with ChangeNotifier {
   Map<Guid, String> readValues = {};
   Set<String> uniqueMessages = {};
   List<DataRow> rows = [];
+  // Aligned round time (us) of each row in [rows]; null for history rows.
+  final List<int?> _rowTimesUs = [];
 
   // Device connection maps.
   Map<String, bool> connectedDevices = {
@@ -68,6 +73,38 @@ class BluetoothManager with ChangeNotifier {
   final Map<String, StreamSubscription<List<int>>> _notificationSubscriptions =
       {};
 
+  // Command (RX) characteristic of each sensor, found during discovery.
+  final Map<String, BluetoothCharacteristic> _commandCharacteristics = {};
+
+  // Punch sequence tracking per sensor: next expected number, recently
+  // seen numbers (drops replayed duplicates) and last Resend request.
+  final Map<String, int> _expectedSeq = {};
+  final Map<String, Set<int>> _seenSeqs = {};
+  final Map<String, DateTime> _lastResendRequest = {};
+
+  // Clock sync per sensor (see clock_sync.dart): the phone timebase, send
+  // time of each pending exchange by id, the estimate, and the sensor time
+  // at which the current round's time was 0.
+  final Stopwatch _phoneClock = Stopwatch()..start();
+  final Map<int, int> _pendingClockSync = {};
+  int _nextClockSyncId = 1;
+  final Map<String, ClockSyncEstimator> _clockSync = {};
+  final Map<String, int> _roundZeroSensorUs = {};
+  final Set<String> _clockSyncRunning = {};
+  Timer? _clockSyncTimer;
+
+  // Health telemetry per sensor (see sensor_diagnostics.dart): the dump
+  // being received, every completed dump (one per session) and the latest
+  // periodic summary.
+  final Map<String, SensorDiagnosticsDump> _pendingDiagnostics = {};
+  final List<SensorDiagnosticsDump> _diagnosticsSessions = [];
+  final Map<String, Map<String, dynamic>> _latestDiagnostics = {};
+
+  List<SensorDiagnosticsDump> get diagnosticsSessions =>
+      List.unmodifiable(_diagnosticsSessions);
+  Map<String, dynamic>? latestDiagnostics(String deviceName) =>
+      _latestDiagnostics[deviceName];
+
   // Scan state and results.
   List<String> availableDevices = [];
   bool isScanning = false;
@@ -94,6 +131,30 @@ class BluetoothManager with ChangeNotifier {
   static final RegExp _punchCountRegex = RegExp(r'Punch Count:\s*([\d:]+)');
   static final RegExp _timestampRegex = RegExp(r'Timestamp:\s*([\d:]+)');
   static final RegExp _sensorValueRegex = RegExp(r'Sensor millivolts:\s*(\d+)');
+  static final RegExp _timeUsRegex = RegExp(r'Time us:\s*(\d+)');
+
+  // Binary punch frame (see ESP32_Beetle_C6_FSR/PunchFrame.h).
+  static const int _punchFrameMarkerV2 = 0xB2;
+  static const int _punchFrameSize = 16;
+  static const int _punchFlagForceCalibrated = 0x01;
+  // Journal download chunk (see ESP32_Beetle_C6_FSR/PunchJournal.h): one
+  // marker byte, then records that each carry a punch frame at offset 4.
+  static const int _journalChunkMarker = 0xB8;
+  static const int _journalRecordSize = 22;
+  static const int _journalFrameOffset = 4;
+  // Raw waveform packet (see ESP32_Beetle_C6_FSR/WaveformPacket.h), only
+  // sent while a diagnostics client streams; the app does not decode it.
+  static const int _waveformMarker = 0xB9;
+  static const List<String> _punchFrameDevices = [
+    'UnknownDevice',
+    'BlueBoxer',
+    'RedBoxer',
+  ];
+  static const String _binaryFormatRequest = '{"PunchFormat":"Binary"}';
+  static const int _seqWindow = 1024;
+  static const Duration _resendHoldoff = Duration(milliseconds: 500);
+  static const Duration _clockSyncSpacing = Duration(milliseconds: 60);
+  static const Duration _clockSyncPeriod = Duration(seconds: 30);
 
   String? _extractValue(String message, RegExp regex) {
     final match = regex.firstMatch(message);
@@ -113,6 +174,7 @@ class BluetoothManager with ChangeNotifier {
   void clearTable() {
     // 1) clear the DataRow list and push an empty list
     rows.clear();
+    _rowTimesUs.clear();
     if (!_messageStreamController.isClosed) {
       _messageStreamController.add([]);
     }
@@ -307,6 +369,9 @@ class BluetoothManager with ChangeNotifier {
       connectedBluetoothDevices[deviceName] = null;
       connectedDevices[deviceName] = false;
       _deviceConnectionNotifiers[deviceName]?.value = false;
+      _commandCharacteristics.remove(deviceName);
+      _clockSync.remove(deviceName);
+      _roundZeroSensorUs.remove(deviceName);
 
       // *** NEW: Cancel any notification subscriptions for this device. ***
       final keysToRemove =
@@ -583,8 +648,12 @@ class BluetoothManager with ChangeNotifier {
               debugPrint(
                 "📡 Discovered ${servicesList.length} services for $deviceName",
               );
+              BluetoothCharacteristic? commandCharacteristic;
               for (var service in servicesList) {
                 for (var characteristic in service.characteristics) {
+                  if (characteristic.properties.write) {
+                    commandCharacteristic = characteristic;
+                  }
                   if (characteristic.properties.notify) {
                     String charKey = '$deviceName-${characteristic.uuid}';
                     if (_notificationSubscriptions.containsKey(charKey)) {
@@ -615,6 +684,22 @@ class BluetoothManager with ChangeNotifier {
                   }
                 }
               }
+              // Ask the sensor for compact binary punch frames; sensors
+              // without support ignore it and keep sending text.
+              if (deviceName != 'BoxerServer' && commandCharacteristic != null) {
+                _commandCharacteristics[deviceName] = commandCharacteristic;
+                await commandCharacteristic.write(
+                  utf8.encode(_binaryFormatRequest),
+                  withoutResponse: false,
+                );
+                debugPrint("📦 Requested binary punch frames from $deviceName");
+                _syncClock(deviceName);
+                _clockSyncTimer ??= Timer.periodic(_clockSyncPeriod, (_) {
+                  for (final name in _commandCharacteristics.keys.toList()) {
+                    _syncClock(name);
+                  }
+                });
+              }
             } catch (e, stackTrace) {
               debugPrint("❌ Error discovering services for $deviceName: $e");
               Sentry.captureException(e, stackTrace: stackTrace);
@@ -629,7 +714,19 @@ class BluetoothManager with ChangeNotifier {
   /// Process incoming notifications.
   void _handleNotification(List<int> value, String deviceName) async {
     if (_disposed) return;
+    final receivedUs = _phoneClock.elapsedMicroseconds; // T4 of a ClockSync
     try {
+      if (value.isNotEmpty && value[0] == _punchFrameMarkerV2) {
+        _handlePunchFrames(value, deviceName);
+        return;
+      }
+      if (value.isNotEmpty && value[0] == _journalChunkMarker) {
+        _handleJournalChunk(value, deviceName);
+        return;
+      }
+      if (value.isNotEmpty && value[0] == _waveformMarker) {
+        return;
+      }
       final decodedMessage = utf8.decode(value);
       debugPrint("📩 Received notification from $deviceName: $decodedMessage");
       try {
@@ -637,6 +734,59 @@ class BluetoothManager with ChangeNotifier {
         if (parsed is Map<String, dynamic> &&
             parsed["RoundState"] == "Completed") {
           _timerState?.endMatch();
+          requestDiagnostics(deviceName);
+        }
+        if (parsed is Map<String, dynamic> && parsed["Diag"] is String) {
+          _pendingDiagnostics
+                  .putIfAbsent(
+                    deviceName,
+                    () => SensorDiagnosticsDump(deviceName, DateTime.now()),
+                  )
+                  .histograms[parsed["Diag"] as String] =
+              DiagnosticsHistogram.fromJson(parsed);
+          return;
+        }
+        if (parsed is Map<String, dynamic> && parsed["Diagnostics"] is Map) {
+          _handleDiagnosticsSummary(
+            deviceName,
+            Map<String, dynamic>.from(parsed["Diagnostics"] as Map),
+          );
+          return;
+        }
+        if (parsed is Map<String, dynamic> && parsed["Round"] is int) {
+          // Round program running on the sensor: follow its boundaries
+          final round = parsed["Round"] as int;
+          if (parsed["RoundState"] == "Started") {
+            _timerState?.sensorRoundStarted(round);
+          } else if (parsed["RoundState"] == "Break") {
+            _timerState?.sensorBreakStarted(round);
+          }
+        }
+        if (parsed is Map<String, dynamic> &&
+            (parsed["RoundState"] == "Started" ||
+                parsed["RoundState"] == "Resumed")) {
+          // Round time restarts or skips the pause: place it again
+          _roundZeroSensorUs.remove(deviceName);
+          _syncClock(deviceName);
+        }
+        if (parsed is Map<String, dynamic> && parsed["ClockSync"] is Map) {
+          _handleClockSync(deviceName, parsed["ClockSync"] as Map, receivedUs);
+          return;
+        }
+        if (parsed is Map<String, dynamic> && parsed["NextSeq"] is int) {
+          // Reply to PunchFormat: catch up on punches sent while we were away
+          _syncSequence(deviceName, parsed["NextSeq"] as int);
+        }
+        if (parsed is Map<String, dynamic> && parsed["Resend"] is Map) {
+          final lost = parsed["Resend"]["Lost"] ?? 0;
+          if (lost > 0) {
+            // Gone from the sensor's RAM, still in its flash journal
+            final fromSeq = ((parsed["Resend"]["FromSeq"] ?? 0) - lost) & 0xFFFF;
+            debugPrint(
+              "⚠️ $deviceName no longer holds $lost missed punches, reading its journal",
+            );
+            _requestJournal(deviceName, fromSeq);
+          }
         }
       } catch (jsonError) {
         // Ignore JSON parsing errors.
@@ -648,43 +798,20 @@ class BluetoothManager with ChangeNotifier {
           (extractedDevice == "UnknownDevice") ? deviceName : extractedDevice;
       final sensorValue = _extractSensorValue(decodedMessage);
       if (punchCount != null && timestamp != null && sensorValue != null) {
-        String oppositeDevice =
-            (deviceStr == "BlueBoxer") ? "RedBoxer" : "BlueBoxer";
-        final newRow = DataRow(
-          cells: [
-            DataCell(Center(child: Text(deviceStr))),
-            DataCell(Center(child: Text(oppositeDevice))),
-            DataCell(Center(child: Text(punchCount.toString()))),
-            DataCell(Center(child: Text(timestamp))),
-            DataCell(Center(child: Text(sensorValue))),
-          ],
-        );
-        rows.add(newRow);
-        _messageStreamController.add(List.from(rows));
-        _scheduleUIUpdate(); // ← debounce rapid‐fire notifications
-
-        final msgMap = {
-          'device': deviceStr,
-          'punchBy': oppositeDevice,
-          'punchCount': punchCount.toString(),
-          'timestamp': timestamp,
-          'sensorValue': sensorValue,
-        };
-        _rawMsgs.add(msgMap);
-        _rawController.sink.add(List.from(_rawMsgs));
-
-        final localRoundId = _currentRoundId;
-        final localMatchId = _currentMatchId;
-        // always insert into messages; matchId can be null (will be stored as NULL)
-        _sendDataAndInsertToDatabase(
-          deviceStr,
-          oppositeDevice,
-          punchCount,
-          timestamp,
-          sensorValue,
-          localRoundId ?? 0,
-          localMatchId,
-        );
+        // Newer sensors add the round time in us; align it like a frame
+        final timeUs = _extractValue(decodedMessage, _timeUsRegex);
+        if (timeUs != null) {
+          final roundUs = _alignedRoundUs(deviceName, int.parse(timeUs));
+          _recordPunch(
+            deviceStr,
+            punchCount,
+            _formatRoundTime(roundUs ~/ 1000),
+            sensorValue,
+            roundUs: roundUs,
+          );
+        } else {
+          _recordPunch(deviceStr, punchCount, timestamp, sensorValue);
+        }
       }
     } catch (e, stackTrace) {
       if (!_disposed) {
@@ -695,6 +822,340 @@ class BluetoothManager with ChangeNotifier {
     }
   }
 
+  /// Decodes binary punch frames: marker, device, seq, count, round time
+  /// in microseconds, peak mV, zone mask, flags and force in 0.1 N
+  /// (little-endian, 16 bytes each).
+  /// The sensor packs several frames back to back into one notification.
+  void _handlePunchFrames(List<int> value, String deviceName) {
+    final data = ByteData.sublistView(Uint8List.fromList(value));
+    var offset = 0;
+    while (offset + _punchFrameSize <= value.length &&
+        data.getUint8(offset) == _punchFrameMarkerV2) {
+      final seq = data.getUint16(offset + 2, Endian.little);
+      if (!_acceptSeq(deviceName, seq)) {
+        offset += _punchFrameSize;
+        continue;
+      }
+      final deviceId = data.getUint8(offset + 1);
+      final punchCount = data.getUint16(offset + 4, Endian.little);
+      final timeUs = data.getUint32(offset + 6, Endian.little);
+      final peakMv = data.getUint16(offset + 10, Endian.little);
+      final forceCalibrated =
+          (data.getUint8(offset + 13) & _punchFlagForceCalibrated) != 0;
+      final forceDn = data.getUint16(offset + 14, Endian.little);
+      debugPrint(
+        "📩 Punch frame from $deviceName: seq=$seq "
+        "count=$punchCount time=${timeUs}us peak=${peakMv}mV zone=${data.getUint8(offset + 12)}"
+        "${forceCalibrated ? ' force=${forceDn / 10}N' : ''}",
+      );
+      final deviceStr =
+          (deviceId > 0 && deviceId < _punchFrameDevices.length)
+              ? _punchFrameDevices[deviceId]
+              : deviceName;
+      final roundUs = _alignedRoundUs(deviceName, timeUs);
+      _recordPunch(
+        deviceStr,
+        punchCount.toString(),
+        _formatRoundTime(roundUs ~/ 1000),
+        peakMv.toString(),
+        roundUs: roundUs,
+      );
+      offset += _punchFrameSize;
+    }
+    if (offset != value.length) {
+      debugPrint(
+        "⚠️ ${value.length - offset} trailing bytes in punch notification from $deviceName",
+      );
+    }
+  }
+
+  /// Frames read back from a sensor's flash journal. They go through the
+  /// punch frame path, which drops the ones already recorded.
+  void _handleJournalChunk(List<int> value, String deviceName) {
+    final frames = <int>[];
+    var offset = 1;
+    while (offset + _journalRecordSize <= value.length) {
+      frames.addAll(
+        value.sublist(
+          offset + _journalFrameOffset,
+          offset + _journalFrameOffset + _punchFrameSize,
+        ),
+      );
+      offset += _journalRecordSize;
+    }
+    if (frames.isNotEmpty) _handlePunchFrames(frames, deviceName);
+  }
+
+  /// Asks a sensor for its telemetry histograms of the session so far and
+  /// starts a new one; the dump lands in [diagnosticsSessions].
+  Future<void> requestDiagnostics(String deviceName, {bool reset = true}) async {
+    final characteristic = _commandCharacteristics[deviceName];
+    if (characteristic == null) return;
+    try {
+      await characteristic.write(
+        utf8.encode('{"Diagnostics":{"Reset":$reset}}'),
+        withoutResponse: false,
+      );
+    } catch (e, stackTrace) {
+      debugPrint("❌ Diagnostics request to $deviceName failed: $e");
+      Sentry.captureException(e, stackTrace: stackTrace);
+    }
+  }
+
+  /// Writes the force curve of one pad: reference weights as
+  /// (millivolts, force in 0.1 N) pairs, increasing and at least 64 mV
+  /// apart. An empty list clears the pad. The sensor answers with
+  /// {"CalibrationUpload":{..,"Status":"Stored"}} or "Rejected".
+  Future<void> uploadForceCurve(
+    String deviceName,
+    int channel,
+    List<List<int>> points,
+  ) async {
+    final characteristic = _commandCharacteristics[deviceName];
+    if (characteristic == null) return;
+    try {
+      await characteristic.write(
+        utf8.encode(
+          jsonEncode({
+            'CalibrationUpload': {'Channel': channel, 'Points': points},
+          }),
+        ),
+        withoutResponse: false,
+      );
+    } catch (e, stackTrace) {
+      debugPrint("❌ Force curve upload to $deviceName failed: $e");
+      Sentry.captureException(e, stackTrace: stackTrace);
+    }
+  }
+
+  /// The summary closes a dump; without one pending it is the periodic
+  /// refresh.
+  void _handleDiagnosticsSummary(
+    String deviceName,
+    Map<String, dynamic> summary,
+  ) {
+    _latestDiagnostics[deviceName] = summary;
+    final dump = _pendingDiagnostics.remove(deviceName);
+    if (dump == null) return;
+    dump.summary = summary;
+    _diagnosticsSessions.add(dump);
+    debugPrint("🩺 ${dump.format()}");
+    _safeNotifyListeners();
+  }
+
+  /// Asks a sensor for the journaled punches of its current session from
+  /// [fromSeq] on.
+  Future<void> _requestJournal(String deviceName, int fromSeq) async {
+    final characteristic = _commandCharacteristics[deviceName];
+    if (characteristic == null) return;
+    try {
+      await characteristic.write(
+        utf8.encode('{"JournalSync":{"FromSeq":$fromSeq}}'),
+        withoutResponse: false,
+      );
+      debugPrint("📼 Asked $deviceName for its journal from seq $fromSeq");
+    } catch (e, stackTrace) {
+      debugPrint("❌ Journal request to $deviceName failed: $e");
+      Sentry.captureException(e, stackTrace: stackTrace);
+    }
+  }
+
+  /// Returns false for a frame already seen (replayed by Resend). A frame
+  /// ahead of the expected number means some were lost: ask for them.
+  bool _acceptSeq(String deviceName, int seq) {
+    final seen = _seenSeqs.putIfAbsent(deviceName, () => <int>{});
+    if (!seen.add(seq)) return false;
+    if (seen.length > _seqWindow) seen.remove(seen.first);
+
+    final expected = _expectedSeq[deviceName];
+    if (expected == null) {
+      _expectedSeq[deviceName] = (seq + 1) & 0xFFFF;
+      return true;
+    }
+    final ahead = (seq - expected) & 0xFFFF;
+    if (ahead < 0x8000) {
+      if (ahead > 0) _requestResend(deviceName, expected);
+      _expectedSeq[deviceName] = (seq + 1) & 0xFFFF;
+    }
+    return true;
+  }
+
+  /// Compares the sensor's next sequence number with ours after
+  /// (re)connecting. Behind us means the sensor restarted.
+  void _syncSequence(String deviceName, int nextSeq) {
+    final expected = _expectedSeq[deviceName];
+    if (expected == null) {
+      _expectedSeq[deviceName] = nextSeq;
+      return;
+    }
+    final ahead = (nextSeq - expected) & 0xFFFF;
+    if (ahead == 0) return;
+    if (ahead < 0x8000) {
+      _requestResend(deviceName, expected);
+    } else {
+      debugPrint("🔄 $deviceName restarted, sequence reset to $nextSeq");
+      _seenSeqs[deviceName]?.clear();
+      _expectedSeq[deviceName] = nextSeq;
+    }
+  }
+
+  Future<void> _requestResend(String deviceName, int fromSeq) async {
+    final characteristic = _commandCharacteristics[deviceName];
+    if (characteristic == null) return;
+    final now = DateTime.now();
+    final last = _lastResendRequest[deviceName];
+    if (last != null && now.difference(last) < _resendHoldoff) return;
+    _lastResendRequest[deviceName] = now;
+    try {
+      await characteristic.write(
+        utf8.encode('{"Resend":{"FromSeq":$fromSeq}}'),
+        withoutResponse: false,
+      );
+      debugPrint("🔁 Asked $deviceName to resend from seq $fromSeq");
+    } catch (e, stackTrace) {
+      debugPrint("❌ Resend request to $deviceName failed: $e");
+      Sentry.captureException(e, stackTrace: stackTrace);
+    }
+  }
+
+  /// Runs one burst of ClockSync exchanges with a sensor. Replies are
+  /// matched by id in [_handleClockSync]; the burst's best sample then
+  /// updates the sensor's offset and drift.
+  Future<void> _syncClock(String deviceName) async {
+    final characteristic = _commandCharacteristics[deviceName];
+    if (characteristic == null || !_clockSyncRunning.add(deviceName)) return;
+    final estimator = _clockSync.putIfAbsent(
+      deviceName,
+      () => ClockSyncEstimator(),
+    );
+    final now = _phoneClock.elapsedMicroseconds;
+    _pendingClockSync.removeWhere((_, sentUs) => now - sentUs > 5000000);
+    try {
+      for (var i = 0; i < ClockSyncEstimator.burstSize; i++) {
+        final id = _nextClockSyncId++;
+        _pendingClockSync[id] = _phoneClock.elapsedMicroseconds;
+        await characteristic.write(
+          utf8.encode('{"ClockSync":{"Id":$id}}'),
+          withoutResponse: false,
+        );
+        await Future.delayed(_clockSyncSpacing);
+      }
+      await Future.delayed(_clockSyncSpacing); // last reply
+      estimator.completeBurst();
+      debugPrint(
+        "⏱️ $deviceName clock offset ${estimator.offsetUs}us, "
+        "drift ${estimator.driftPpm.toStringAsFixed(1)}ppm, "
+        "delay ${estimator.lastDelayUs}us",
+      );
+    } catch (e, stackTrace) {
+      debugPrint("❌ Clock sync with $deviceName failed: $e");
+      Sentry.captureException(e, stackTrace: stackTrace);
+    } finally {
+      _clockSyncRunning.remove(deviceName);
+    }
+  }
+
+  void _handleClockSync(String deviceName, Map reply, int receivedUs) {
+    final sentUs = _pendingClockSync.remove(reply["Id"]);
+    final t2 = reply["T2"];
+    final t3 = reply["T3"];
+    if (sentUs == null || t2 is! int || t3 is! int) return;
+    _clockSync
+        .putIfAbsent(deviceName, () => ClockSyncEstimator())
+        .addSample(ClockSample(sentUs, t2, t3, receivedUs));
+    final roundUs = reply["RoundUs"];
+    if (reply["Detecting"] == true && roundUs is int) {
+      _roundZeroSensorUs[deviceName] = t3 - roundUs;
+    }
+  }
+
+  /// Round time of a punch on the timeline shared by all synced sensors:
+  /// mapped to phone time through the sensor's clock estimate and measured
+  /// from the earliest sensor round start. Starts reach the two boxers
+  /// through separate BLE writes, so their own round times are skewed.
+  /// Returned unchanged until the sensor has been synced in this round.
+  int _alignedRoundUs(String deviceName, int roundUs) {
+    final estimator = _clockSync[deviceName];
+    final zero = _roundZeroSensorUs[deviceName];
+    if (estimator == null || !estimator.isSynced || zero == null) {
+      return roundUs;
+    }
+    var origin = estimator.sensorToPhone(zero);
+    for (final entry in _roundZeroSensorUs.entries) {
+      final other = _clockSync[entry.key];
+      if (other == null || !other.isSynced) continue;
+      origin = min(origin, other.sensorToPhone(entry.value));
+    }
+    return estimator.sensorToPhone(zero + roundUs) - origin;
+  }
+
+  /// Same mm:ss:hh layout the sensor uses in its text messages.
+  String _formatRoundTime(int milliseconds) {
+    final minutes = milliseconds ~/ 60000;
+    final seconds = (milliseconds % 60000) ~/ 1000;
+    final hundredths = (milliseconds % 1000) ~/ 10;
+    String two(int v) => v.toString().padLeft(2, '0');
+    return '${two(minutes)}:${two(seconds)}:${two(hundredths)}';
+  }
+
+  /// Adds a punch to the table, raw stream, database and BoxerServer.
+  void _recordPunch(
+    String deviceStr,
+    String punchCount,
+    String timestamp,
+    String sensorValue, {
+    int? roundUs,
+  }) {
+    String oppositeDevice =
+        (deviceStr == "BlueBoxer") ? "RedBoxer" : "BlueBoxer";
+    final newRow = DataRow(
+      cells: [
+        DataCell(Center(child: Text(deviceStr))),
+        DataCell(Center(child: Text(oppositeDevice))),
+        DataCell(Center(child: Text(punchCount))),
+        DataCell(Center(child: Text(timestamp))),
+        DataCell(Center(child: Text(sensorValue))),
+      ],
+    );
+    // Merge both boxers' streams in aligned round-time order: a punch
+    // notified late lands where it happened instead of at the end.
+    var index = rows.length;
+    if (roundUs != null) {
+      while (index > 0 &&
+          _rowTimesUs[index - 1] != null &&
+          _rowTimesUs[index - 1]! > roundUs) {
+        index--;
+      }
+    }
+    rows.insert(index, newRow);
+    _rowTimesUs.insert(index, roundUs);
+    _messageStreamController.add(List.from(rows));
+    _scheduleUIUpdate(); // ← debounce rapid‐fire notifications
+
+    final msgMap = {
+      'device': deviceStr,
+      'punchBy': oppositeDevice,
+      'punchCount': punchCount,
+      'timestamp': timestamp,
+      'sensorValue': sensorValue,
+    };
+    _rawMsgs.add(msgMap);
+    _rawController.sink.add(List.from(_rawMsgs));
+
+    final localRoundId = _currentRoundId;
+    final localMatchId = _currentMatchId;
+    // always insert into messages; matchId can be null (will be stored as NULL)
+    _sendDataAndInsertToDatabase(
+      deviceStr,
+      oppositeDevice,
+      punchCount,
+      timestamp,
+      sensorValue,
+      localRoundId ?? 0,
+      localMatchId,
+    );
+  }
+
   /// Send data and insert into the database concurrently.
   void _sendDataAndInsertToDatabase(
     String deviceStr,
@@ -791,6 +1252,7 @@ class BluetoothManager with ChangeNotifier {
 
       // Add to your internal list and stream
       rows.add(row);
+      _rowTimesUs.add(null);
       _messageStreamController.add(List.from(rows));
 
       // **NEW**: record raw msg and emit
@@ -990,6 +1452,7 @@ class BluetoothManager with ChangeNotifier {
   @override
   void dispose() {
     _notifyDebounce?.cancel();
+    _clockSyncTimer?.cancel();
     try {
       _messageStreamController.close();
       _disconnectionStreamController.close();
@@ -0,0 +1,114 @@
+// lib/services/clock_sync.dart
+
+/// One NTP-style timestamp exchange with a sensor, in microseconds: phone
+/// send (t1), sensor receive (t2) and reply (t3), phone receive (t4).
+class ClockSample {
+  final int t1;
+  final int t2;
+  final int t3;
+  final int t4;
+
+  const ClockSample(this.t1, this.t2, this.t3, this.t4);
+
+  /// Sensor clock minus phone clock, assuming a symmetric link.
+  int get offsetUs => ((t2 - t1) + (t3 - t4)) ~/ 2;
+
+  /// Round trip spent on the link, without the sensor's own work.
+  int get delayUs => (t4 - t1) - (t3 - t2);
+
+  /// Phone time the offset is measured at.
+  int get phoneUs => (t1 + t4) ~/ 2;
+}
+
+/// Estimates one sensor's clock against the phone's:
+/// sensor = phone + offset + drift * (phone - reference).
+///
+/// Samples come in bursts; the one with the shortest round trip is the
+/// least disturbed by BLE connection-event timing and is kept. Offset and
+/// drift are a least-squares line through the last [maxPoints] bursts.
+class ClockSyncEstimator {
+  static const int burstSize = 8;
+  static const int maxPoints = 16;
+  static const int restartThresholdUs = 1000000;
+
+  final List<ClockSample> _burst = [];
+  final List<ClockSample> _points = [];
+  int _referenceUs = 0;
+  int _offsetUs = 0;
+  double _drift = 0;
+
+  bool get isSynced => _points.isNotEmpty;
+  int get offsetUs => _offsetUs;
+  double get driftPpm => _drift * 1e6;
+
+  /// Round trip of the best sample in the latest burst.
+  int? get lastDelayUs => _points.isEmpty ? null : _points.last.delayUs;
+
+  void addSample(ClockSample sample) {
+    if (sample.delayUs < 0) return;
+    // A jump this large means the sensor rebooted: its clock restarted
+    if (isSynced &&
+        (sample.offsetUs - _predictOffset(sample.phoneUs)).abs() >
+            restartThresholdUs) {
+      reset();
+    }
+    _burst.add(sample);
+  }
+
+  int _predictOffset(int phoneUs) =>
+      _offsetUs + (_drift * (phoneUs - _referenceUs)).round();
+
+  /// Keeps the best sample of the burst and refits offset and drift.
+  void completeBurst() {
+    if (_burst.isEmpty) return;
+    var best = _burst.first;
+    for (final sample in _burst) {
+      if (sample.delayUs < best.delayUs) best = sample;
+    }
+    _burst.clear();
+    _points.add(best);
+    if (_points.length > maxPoints) _points.removeAt(0);
+    _fit();
+  }
+
+  void _fit() {
+    _referenceUs = _points.last.phoneUs;
+    if (_points.length == 1) {
+      _offsetUs = _points.first.offsetUs;
+      _drift = 0;
+      return;
+    }
+    // Centered sums keep the products well inside double precision.
+    var meanX = 0.0;
+    var meanY = 0.0;
+    for (final p in _points) {
+      meanX += p.phoneUs - _referenceUs;
+      meanY += p.offsetUs;
+    }
+    meanX /= _points.length;
+    meanY /= _points.length;
+    var sxx = 0.0;
+    var sxy = 0.0;
+    for (final p in _points) {
+      final dx = p.phoneUs - _referenceUs - meanX;
+      sxx += dx * dx;
+      sxy += dx * (p.offsetUs - meanY);
+    }
+    _drift = sxx > 0 ? sxy / sxx : 0;
+    _offsetUs = (meanY - _drift * meanX).round();
+  }
+
+  /// Phone time at which the sensor clock reads [sensorUs].
+  int sensorToPhone(int sensorUs) {
+    // sensor = phone + offset + drift * (phone - reference), solved for phone
+    return ((sensorUs - _offsetUs + _drift * _referenceUs) / (1 + _drift))
+        .round();
+  }
+
+  void reset() {
+    _burst.clear();
+    _points.clear();
+    _offsetUs = 0;
+    _drift = 0;
+  }
+}
@@ -0,0 +1,72 @@
+// lib/services/sensor_diagnostics.dart
+
+/// One fixed-bucket histogram from a sensor's diagnostics characteristic
+/// (see ESP32_Beetle_C6_FSR/Telemetry.h). Width 0 means power-of-two
+/// buckets: bucket 0 holds 0, bucket n holds [2^(n-1), 2^n).
+class DiagnosticsHistogram {
+  final String name;
+  final int width;
+  final int count;
+  final int max;
+  final int p50;
+  final int p99;
+  final List<int> buckets;
+
+  const DiagnosticsHistogram({
+    required this.name,
+    required this.width,
+    required this.count,
+    required this.max,
+    required this.p50,
+    required this.p99,
+    required this.buckets,
+  });
+
+  factory DiagnosticsHistogram.fromJson(Map<String, dynamic> json) {
+    return DiagnosticsHistogram(
+      name: json['Diag'] as String,
+      width: json['Width'] as int? ?? 0,
+      count: json['N'] as int? ?? 0,
+      max: json['Max'] as int? ?? 0,
+      p50: json['P50'] as int? ?? 0,
+      p99: json['P99'] as int? ?? 0,
+      buckets: (json['B'] as List? ?? const []).cast<int>(),
+    );
+  }
+
+  int bucketLow(int bucket) {
+    if (width > 0) return bucket * width;
+    return bucket == 0 ? 0 : 1 << (bucket - 1);
+  }
+
+  String format() {
+    final lines = StringBuffer(
+      '$name: n=$count p50=$p50 p99=$p99 max=$max\n',
+    );
+    for (var i = 0; i < buckets.length; i++) {
+      if (buckets[i] == 0) continue;
+      lines.writeln('  >= ${bucketLow(i)}: ${buckets[i]}');
+    }
+    return lines.toString();
+  }
+}
+
+/// Histograms one sensor reported for one session, completed by the
+/// summary the sensor sends after them.
+class SensorDiagnosticsDump {
+  final String deviceName;
+  final DateTime takenAt;
+  final Map<String, DiagnosticsHistogram> histograms = {};
+  Map<String, dynamic> summary = const {};
+
+  SensorDiagnosticsDump(this.deviceName, this.takenAt);
+
+  String format() {
+    final text = StringBuffer('Diagnostics $deviceName @ $takenAt\n');
+    summary.forEach((key, value) => text.writeln('  $key: $value'));
+    for (final histogram in histograms.values) {
+      text.write(histogram.format());
+    }
+    return text.toString();
+  }
+}
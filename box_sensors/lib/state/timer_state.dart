@@ -30,6 +30,11 @@ class TimerState with ChangeNotifier {
   bool _isResumeButtonDisabled = true;
 
   VoidCallback? _sendSettingsAndStartRoundCallback;
+  // Set once a sensor reports it runs the round program itself
+  // (SensorSettings Rounds). Its RoundState events then decide the round
+  // and break boundaries; the local countdown only displays them.
+  bool _sensorScheduled = false;
+  int _insertedRound = 0;
   final AudioPlayer _audioPlayer = AudioPlayer();
 
   // Database & Bluetooth dependencies, to be set via initialize().
@@ -108,6 +113,8 @@ class TimerState with ChangeNotifier {
   /// Called once to kick off Round 1 and every subsequent round via the callback.
   void startCountdown(VoidCallback sendStartRoundCallback) => _safeCall(() {
     _sendSettingsAndStartRoundCallback = sendStartRoundCallback;
+    _sensorScheduled = false;
+    _insertedRound = 0;
     _matchState = MatchState.running;
     _round = 1;
     _countdown = roundTime;
@@ -144,8 +151,9 @@ class TimerState with ChangeNotifier {
     _matchState = MatchState.running;
     notifyListeners();
 
-    _sendSettingsAndStartRoundCallback?.call();
-    _insertRound();
+    // A scheduling sensor starts the next round on its own
+    if (!_sensorScheduled) _sendSettingsAndStartRoundCallback?.call();
+    if (_insertedRound != _round) _insertRound();
 
     _timer?.cancel();
     _timer = Timer.periodic(const Duration(seconds: 1), (t) {
@@ -190,6 +198,35 @@ class TimerState with ChangeNotifier {
     });
   });
 
+  /// A sensor started [round] on its own clock. Moves the countdown to it
+  /// unless it is already there (started locally or by the other sensor).
+  void sensorRoundStarted(int round) => _safeCall(() {
+    _sensorScheduled = true;
+    if (_matchState != MatchState.running &&
+        _matchState != MatchState.breakTime) {
+      return;
+    }
+    if (_matchState == MatchState.running &&
+        _round == round &&
+        _countdown >= roundTime - 1) {
+      return;
+    }
+    _round = round;
+    _startRound();
+  });
+
+  /// A sensor ended [round] and started the break after it.
+  void sensorBreakStarted(int round) => _safeCall(() {
+    _sensorScheduled = true;
+    if (_round != round) return;
+    if (_matchState == MatchState.running ||
+        (_matchState == MatchState.breakTime &&
+            _countdown < breakTime - 1)) {
+      _startBreak();
+      notifyListeners();
+    }
+  });
+
   /// Ends the match.
   void endMatch() => _safeCall(_endMatch);
   
@@ -295,6 +332,7 @@ class TimerState with ChangeNotifier {
 
   /// Inserts a new round into the database and updates BluetoothManager.
   Future<void> _insertRound() async {
+    _insertedRound = _round;
     if (_matchId != null) {
       try {
         final roundId = await _dbHelper.insertRound(